@@ -3,6 +3,7 @@
 set prefix="C:\Program Files\Fraqtive"
 set config=release
 set sse2=sse2
+set avx2=avx2
 set msvc=no
 
 if exist .\fraqtive.pro goto arg_loop
@@ -15,6 +16,7 @@ if "%1" == "" goto arg_done
 if "%1" == "-prefix" goto arg_prefix
 if "%1" == "-debug" goto arg_debug
 if "%1" == "-no-sse2" goto arg_nosse2
+if "%1" == "-no-avx2" goto arg_noavx2
 if "%1" == "-msvc" goto arg_msvc
 if "%1" == "-help" goto show_usage
 if "%1" == "--help" goto show_usage
@@ -36,6 +38,10 @@ goto arg_next
 set sse2=no-sse2
 goto arg_next
 
+:arg_noavx2
+set avx2=no-avx2
+goto arg_next
+
 :arg_msvc
 set msvc=yes
 goto arg_next
@@ -53,6 +59,7 @@ echo   -prefix DIR   Set the instalation directory to DIR
 echo                   (default: C:\Program Files\Fraqtive)
 echo   -debug        Build with debugging symbols
 echo   -no-sse2      Do not compile with use of SSE2 instructions
+echo   -no-avx2      Do not compile with use of AVX2 instructions
 echo   -msvc         Generate Visual Studio solution
 goto end
 
@@ -83,7 +90,7 @@ goto end
 echo Writing configuration file...
 
 echo # this file was generated by configure.bat >config.pri
-echo CONFIG += %config% %sse2% >>config.pri
+echo CONFIG += %config% %sse2% %avx2% >>config.pri
 echo PREFIX = %prefix:\=\\% >>config.pri
 
 if "%msvc%" == "yes" goto gen_msvc
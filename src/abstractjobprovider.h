@@ -28,6 +28,14 @@ public:
 public:
     virtual int priority() const = 0;
 
+    // the number of jobs which may be executed at the same time; 0 means
+    // that the number is limited only by the number of threads
+    virtual int maximumJobs() const { return 0; }
+
+    // the jobs of background providers are executed after the jobs of the
+    // interactive ones, regardless of priority, and never occupy all threads
+    virtual bool isBackground() const { return false; }
+
     virtual void executeJob() = 0;
 };
 
@@ -57,6 +57,26 @@ void AdvancedSettingsPage::on_sliderDetail_valueChanged()
     saveGenerator();
 }
 
+void AdvancedSettingsPage::on_radioSamplingGrid_clicked()
+{
+    saveGenerator();
+}
+
+void AdvancedSettingsPage::on_radioSamplingQuadtree_clicked()
+{
+    saveGenerator();
+}
+
+void AdvancedSettingsPage::on_radioSamplingRectangles_clicked()
+{
+    saveGenerator();
+}
+
+void AdvancedSettingsPage::on_radioSamplingVerified_clicked()
+{
+    saveGenerator();
+}
+
 void AdvancedSettingsPage::on_radioAANone_clicked()
 {
     saveView();
@@ -161,6 +181,21 @@ void AdvancedSettingsPage::loadGenerator()
     m_ui.sliderDepth->setScaledValue( settings.calculationDepth() );
     m_ui.sliderDetail->setScaledValue( settings.detailThreshold() );
 
+    switch ( settings.samplingMethod() ) {
+        case GridSampling:
+            m_ui.radioSamplingGrid->setChecked( true );
+            break;
+        case RectangleSampling:
+            m_ui.radioSamplingRectangles->setChecked( true );
+            break;
+        case VerifiedRectangleSampling:
+            m_ui.radioSamplingVerified->setChecked( true );
+            break;
+        case QuadtreeSampling:
+            m_ui.radioSamplingQuadtree->setChecked( true );
+            break;
+    }
+
     m_loading = false;
 }
 
@@ -172,6 +207,16 @@ void AdvancedSettingsPage::saveGenerator()
     GeneratorSettings settings;
     settings.setCalculationDepth( m_ui.sliderDepth->scaledValue() );
     settings.setDetailThreshold( m_ui.sliderDetail->scaledValue() );
+
+    if ( m_ui.radioSamplingGrid->isChecked() )
+        settings.setSamplingMethod( GridSampling );
+    if ( m_ui.radioSamplingQuadtree->isChecked() )
+        settings.setSamplingMethod( QuadtreeSampling );
+    if ( m_ui.radioSamplingRectangles->isChecked() )
+        settings.setSamplingMethod( RectangleSampling );
+    if ( m_ui.radioSamplingVerified->isChecked() )
+        settings.setSamplingMethod( VerifiedRectangleSampling );
+
     m_model->setGeneratorSettings( settings );
 }
 
@@ -38,6 +38,10 @@ public:
 private slots:
     void on_sliderDepth_valueChanged();
     void on_sliderDetail_valueChanged();
+    void on_radioSamplingGrid_clicked();
+    void on_radioSamplingQuadtree_clicked();
+    void on_radioSamplingRectangles_clicked();
+    void on_radioSamplingVerified_clicked();
     void on_radioAANone_clicked();
     void on_radioAALow_clicked();
     void on_radioAAMedium_clicked();
@@ -185,6 +185,17 @@ int BookmarkModel::priority() const
     return 1;
 }
 
+int BookmarkModel::maximumJobs() const
+{
+    // the thumbnails are calculated in the background using a single thread
+    return 1;
+}
+
+bool BookmarkModel::isBackground() const
+{
+    return true;
+}
+
 static int roundToCellSize( int size )
 {
     // round up to nearest N * CellSize + 1
@@ -258,10 +269,15 @@ void BookmarkModel::calculate( const Bookmark& bookmark, double* buffer, const Q
     double offsetX = -(double)resolution.width() / 2.0 - 0.5;
     double offsetY = -(double)resolution.height() / 2.0 - 0.5;
 
+    Precision precision = DataFunctions::requiredPrecision( bookmark.fractalType(), position, resolution );
+
+    // the extended precision functors use coordinates relative to the center
+    QPointF center = ( precision >= DoubleDoublePrecision ) ? QPointF() : position.center();
+
     input.m_sa = sa;
     input.m_ca = ca;
-    input.m_x = position.center().x() + ca * offsetX + sa * offsetY;
-    input.m_y = position.center().y() - sa * offsetX + ca * offsetY;
+    input.m_x = center.x() + ca * offsetX + sa * offsetY;
+    input.m_y = center.y() - sa * offsetX + ca * offsetY;
 
     GeneratorCore::Output output;
 
@@ -269,14 +285,40 @@ void BookmarkModel::calculate( const Bookmark& bookmark, double* buffer, const Q
     output.m_width = size.width();
     output.m_height = size.height();
     output.m_stride = size.width();
+    output.m_known = NULL;
+    output.m_continuation = NULL;
 
     GeneratorSettings settings = DataFunctions::defaultGeneratorSettings();
 
     int maxIterations = (int)( pow( 10.0, settings.calculationDepth() ) * qMax( 1.0, 1.45 + position.zoomFactor() ) );
     double threshold = settings.detailThreshold();
 
+    if ( precision == PerturbationPrecision ) {
+        GeneratorCore::ReferenceOrbit* orbit = DataFunctions::createReferenceOrbit( bookmark.fractalType(), position, maxIterations );
+        GeneratorCore::Functor* functor = DataFunctions::createPerturbationFunctor( bookmark.fractalType(), orbit );
+        if ( functor ) {
+            GeneratorCore::generatePreview( input, output, functor, maxIterations );
+            GeneratorCore::interpolate( output );
+            GeneratorCore::generateDetails( input, output, functor, maxIterations, threshold );
+            delete functor;
+        }
+        delete orbit;
+        return;
+    }
+
+#if defined( HAVE_AVX2 )
+    GeneratorCore::FunctorAVX2* functorAVX2 = DataFunctions::createFunctorAVX2( bookmark.fractalType(), position, resolution, precision );
+    if ( functorAVX2 ) {
+        GeneratorCore::generatePreviewAVX2( input, output, functorAVX2, maxIterations );
+        GeneratorCore::interpolate( output );
+        GeneratorCore::generateDetailsAVX2( input, output, functorAVX2, maxIterations, threshold );
+        delete functorAVX2;
+        return;
+    }
+#endif
+
 #if defined( HAVE_SSE2 )
-    GeneratorCore::FunctorSSE2* functorSSE2 = DataFunctions::createFunctorSSE2( bookmark.fractalType() );
+    GeneratorCore::FunctorSSE2* functorSSE2 = DataFunctions::createFunctorSSE2( bookmark.fractalType(), position, resolution, precision );
     if ( functorSSE2 ) {
         GeneratorCore::generatePreviewSSE2( input, output, functorSSE2, maxIterations );
         GeneratorCore::interpolate( output );
@@ -286,7 +328,7 @@ void BookmarkModel::calculate( const Bookmark& bookmark, double* buffer, const Q
     }
 #endif
 
-    GeneratorCore::Functor* functor = DataFunctions::createFunctor( bookmark.fractalType() );
+    GeneratorCore::Functor* functor = DataFunctions::createFunctor( bookmark.fractalType(), position, resolution, precision );
     if ( functor ) {
         GeneratorCore::generatePreview( input, output, functor, maxIterations );
         GeneratorCore::interpolate( output );
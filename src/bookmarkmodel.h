@@ -55,6 +55,10 @@ public: // overrides
 public: // AbstractJobProvider implementation
     int priority() const;
 
+    int maximumJobs() const;
+
+    bool isBackground() const;
+
     void executeJob();
 
 private:
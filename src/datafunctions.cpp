@@ -19,9 +19,14 @@
 #include "datafunctions.h"
 #include "fractaldata.h"
 
+#include <math.h>
+#include <float.h>
+
 namespace DataFunctions
 {
 
+static const double DoubleDoubleEpsilon = 4.93038065763132e-32; // 2^-104
+
 Position defaultPosition( const FractalType& type )
 {
     Position position;
@@ -97,6 +102,7 @@ GeneratorSettings defaultGeneratorSettings()
 
     settings.setCalculationDepth( 2.5 );
     settings.setDetailThreshold( 0.9 );
+    settings.setSamplingMethod( GridSampling );
 
     return settings;
 }
@@ -312,15 +318,15 @@ void drawImage( QImage& image, const QPoint& point, const FractalData* data, con
     }
 }
 
-GeneratorCore::Functor* createFunctor( const FractalType& type )
+GeneratorCore::Functor* createFunctor( const FractalType& type, double tolerance )
 {
     switch ( type.exponentType() ) {
         case IntegralExponent:
             if ( type.fractal() == MandelbrotFractal ) {
-                return GeneratorCore::createMandelbrotFastFunctor( type.integralExponent(), type.variant() );
+                return GeneratorCore::createMandelbrotFastFunctor( type.integralExponent(), type.variant(), tolerance );
             } else {
                 return GeneratorCore::createJuliaFastFunctor( type.parameter().x(),
-                    type.parameter().y(), type.integralExponent(), type.variant() );
+                    type.parameter().y(), type.integralExponent(), type.variant(), tolerance );
             }
             break;
 
@@ -337,23 +343,236 @@ GeneratorCore::Functor* createFunctor( const FractalType& type )
     return NULL;
 }
 
+static double cycleTolerance( const Position& position, const QSize& resolution )
+{
+    // a small fraction of the distance between pixels, so that only orbits
+    // which are indistinguishable from a cycle at this resolution are treated
+    // as periodic
+    return pow( 10.0, -position.zoomFactor() ) / (double)resolution.height() / 1024.0;
+}
+
+Precision requiredPrecision( const FractalType& type, const Position& position, const QSize& resolution )
+{
+    // the real exponent kernels only support double precision
+    if ( type.exponentType() != IntegralExponent )
+        return DoublePrecision;
+
+    double scale = pow( 10.0, -position.zoomFactor() ) / (double)resolution.height();
+
+    QPointF center = position.center();
+    double magnitude = qMax( qMax( fabs( center.x() ), fabs( center.y() ) ), 1.0 );
+
+    // rounding errors of single precision accumulate quickly on the boundary
+    // of the set, so it's only used when pixels are thousands of units in the
+    // last place apart, which covers the initial view of the fractal
+    if ( scale >= 4096.0 * FLT_EPSILON * magnitude )
+        return SinglePrecision;
+
+    // the distance between pixels must be at least four units in the last place
+    if ( scale >= 4.0 * DBL_EPSILON * magnitude )
+        return DoublePrecision;
+
+    // perturbation is not possible for julia sets, which are limited to
+    // double-double precision
+    if ( type.fractal() != MandelbrotFractal || scale >= 4.0 * DoubleDoubleEpsilon * magnitude )
+        return DoubleDoublePrecision;
+
+    return PerturbationPrecision;
+}
+
+double maximumZoomFactor( const FractalType& type )
+{
+    if ( type.exponentType() != IntegralExponent )
+        return floor( -log10( DBL_EPSILON ) );
+
+    if ( type.fractal() != MandelbrotFractal )
+        return floor( -log10( DoubleDoubleEpsilon ) );
+
+    // the limit of the zoom spin box; perturbation uses fixed point
+    // reference orbits which can be extended as needed
+    return 300.0;
+}
+
+GeneratorCore::Functor* createFunctor( const FractalType& type, const Position& position, const QSize& resolution, Precision precision )
+{
+    double tolerance = cycleTolerance( position, resolution );
+
+    switch ( precision ) {
+        // there is no scalar single precision functor
+        case SinglePrecision:
+        case DoublePrecision:
+            return createFunctor( type, tolerance );
+
+        case DoubleDoublePrecision:
+            if ( type.fractal() == MandelbrotFractal ) {
+                return GeneratorCore::createMandelbrotDoubleDoubleFunctor( position.centerX(), position.centerY(),
+                    type.integralExponent(), type.variant() );
+            } else if ( type.fractal() == JuliaFractal ) {
+                return GeneratorCore::createJuliaDoubleDoubleFunctor( position.centerX(), position.centerY(),
+                    type.parameter().x(), type.parameter().y(), type.integralExponent(), type.variant() );
+            }
+            break;
+
+        case PerturbationPrecision:
+            break;
+    }
+
+    return NULL;
+}
+
+GeneratorCore::ReferenceOrbit* createReferenceOrbit( const FractalType& type, const Position& position, int maxIterations,
+    const GeneratorCore::Cancellation* cancellation )
+{
+    // the precision of the orbit must exceed the distance between pixels
+    int bits = (int)( position.zoomFactor() * 3.33 ) + 64;
+
+    FixedPoint cx = position.centerX();
+    FixedPoint cy = position.centerY();
+    cx.setSize( qMax( cx.size(), FixedPoint::sizeForBits( bits ) ) );
+    cy.setSize( qMax( cy.size(), FixedPoint::sizeForBits( bits ) ) );
+
+    return GeneratorCore::createMandelbrotOrbit( cx, cy, type.integralExponent(), type.variant(), maxIterations, cancellation );
+}
+
+GeneratorCore::Functor* createPerturbationFunctor( const FractalType& type, const GeneratorCore::ReferenceOrbit* orbit )
+{
+    return GeneratorCore::createMandelbrotPerturbationFunctor( orbit, type.integralExponent(), type.variant() );
+}
+
 #if defined( HAVE_SSE2 )
 
-GeneratorCore::FunctorSSE2* createFunctorSSE2( const FractalType& type )
+GeneratorCore::FunctorSSE2* createFunctorSSE2( const FractalType& type, double tolerance )
 {
     switch ( type.exponentType() ) {
         case IntegralExponent:
             if ( GeneratorCore::isSSE2Available() ) {
                 if ( type.fractal() == MandelbrotFractal ) {
-                    return GeneratorCore::createMandelbrotFunctorSSE2( type.integralExponent(), type.variant() );
+                    return GeneratorCore::createMandelbrotFunctorSSE2( type.integralExponent(), type.variant(), tolerance );
                 } else if ( type.fractal() == JuliaFractal ) {
                     return GeneratorCore::createJuliaFunctorSSE2( type.parameter().x(),
-                        type.parameter().y(), type.integralExponent(), type.variant() );
+                        type.parameter().y(), type.integralExponent(), type.variant(), tolerance );
+                }
+            }
+            break;
+
+        case RealExponent:
+            if ( GeneratorCore::isSSE2Available() ) {
+                if ( type.fractal() == MandelbrotFractal ) {
+                    return GeneratorCore::createMandelbrotRealFunctorSSE2( type.realExponent(), type.variant() );
+                } else if ( type.fractal() == JuliaFractal ) {
+                    return GeneratorCore::createJuliaRealFunctorSSE2( type.parameter().x(),
+                        type.parameter().y(), type.realExponent(), type.variant() );
+                }
+            }
+            break;
+    }
+
+    return NULL;
+}
+
+GeneratorCore::FunctorSSE2* createFunctorSSE2( const FractalType& type, const Position& position, const QSize& resolution, Precision precision )
+{
+    double tolerance = cycleTolerance( position, resolution );
+
+    switch ( precision ) {
+        case SinglePrecision:
+            if ( GeneratorCore::isSSE2Available() ) {
+                if ( type.fractal() == MandelbrotFractal ) {
+                    return GeneratorCore::createMandelbrotFloatFunctorSSE2( type.integralExponent(), type.variant(), tolerance );
+                } else if ( type.fractal() == JuliaFractal ) {
+                    return GeneratorCore::createJuliaFloatFunctorSSE2( type.parameter().x(),
+                        type.parameter().y(), type.integralExponent(), type.variant(), tolerance );
+                }
+            }
+            break;
+
+        case DoublePrecision:
+            return createFunctorSSE2( type, tolerance );
+
+        case DoubleDoublePrecision:
+            if ( GeneratorCore::isSSE2Available() ) {
+                if ( type.fractal() == MandelbrotFractal ) {
+                    return GeneratorCore::createMandelbrotDoubleDoubleFunctorSSE2( position.centerX(), position.centerY(),
+                        type.integralExponent(), type.variant() );
+                } else if ( type.fractal() == JuliaFractal ) {
+                    return GeneratorCore::createJuliaDoubleDoubleFunctorSSE2( position.centerX(), position.centerY(),
+                        type.parameter().x(), type.parameter().y(), type.integralExponent(), type.variant() );
+                }
+            }
+            break;
+
+        case PerturbationPrecision:
+            break;
+    }
+
+    return NULL;
+}
+
+#endif
+
+#if defined( HAVE_AVX2 )
+
+GeneratorCore::FunctorAVX2* createFunctorAVX2( const FractalType& type, double tolerance )
+{
+    switch ( type.exponentType() ) {
+        case IntegralExponent:
+            if ( GeneratorCore::isAVX2Available() ) {
+                if ( type.fractal() == MandelbrotFractal ) {
+                    return GeneratorCore::createMandelbrotFunctorAVX2( type.integralExponent(), type.variant(), tolerance );
+                } else if ( type.fractal() == JuliaFractal ) {
+                    return GeneratorCore::createJuliaFunctorAVX2( type.parameter().x(),
+                        type.parameter().y(), type.integralExponent(), type.variant(), tolerance );
+                }
+            }
+            break;
+
+        case RealExponent:
+            if ( GeneratorCore::isAVX2Available() ) {
+                if ( type.fractal() == MandelbrotFractal ) {
+                    return GeneratorCore::createMandelbrotRealFunctorAVX2( type.realExponent(), type.variant() );
+                } else if ( type.fractal() == JuliaFractal ) {
+                    return GeneratorCore::createJuliaRealFunctorAVX2( type.parameter().x(),
+                        type.parameter().y(), type.realExponent(), type.variant() );
+                }
+            }
+            break;
+    }
+
+    return NULL;
+}
+
+GeneratorCore::FunctorAVX2* createFunctorAVX2( const FractalType& type, const Position& position, const QSize& resolution, Precision precision )
+{
+    double tolerance = cycleTolerance( position, resolution );
+
+    switch ( precision ) {
+        case SinglePrecision:
+            if ( GeneratorCore::isAVX2Available() ) {
+                if ( type.fractal() == MandelbrotFractal ) {
+                    return GeneratorCore::createMandelbrotFloatFunctorAVX2( type.integralExponent(), type.variant(), tolerance );
+                } else if ( type.fractal() == JuliaFractal ) {
+                    return GeneratorCore::createJuliaFloatFunctorAVX2( type.parameter().x(),
+                        type.parameter().y(), type.integralExponent(), type.variant(), tolerance );
+                }
+            }
+            break;
+
+        case DoublePrecision:
+            return createFunctorAVX2( type, tolerance );
+
+        case DoubleDoublePrecision:
+            if ( GeneratorCore::isAVX2Available() ) {
+                if ( type.fractal() == MandelbrotFractal ) {
+                    return GeneratorCore::createMandelbrotDoubleDoubleFunctorAVX2( position.centerX(), position.centerY(),
+                        type.integralExponent(), type.variant() );
+                } else if ( type.fractal() == JuliaFractal ) {
+                    return GeneratorCore::createJuliaDoubleDoubleFunctorAVX2( position.centerX(), position.centerY(),
+                        type.parameter().x(), type.parameter().y(), type.integralExponent(), type.variant() );
                 }
             }
             break;
 
-        default:
+        case PerturbationPrecision:
             break;
     }
 
@@ -61,11 +61,34 @@ private:
 void drawImage( QImage& image, const FractalData* data, const QRect& region, const ColorMapper& mapper, AntiAliasing antiAliasing );
 void drawImage( QImage& image, const QPoint& point, const FractalData* data, const QRect& region, const ColorMapper& mapper, AntiAliasing antiAliasing );
 
-GeneratorCore::Functor* createFunctor( const FractalType& type );
+GeneratorCore::Functor* createFunctor( const FractalType& type, double tolerance );
+
+Precision requiredPrecision( const FractalType& type, const Position& position, const QSize& resolution );
+
+// the highest zoom factor which can be resolved by the precision available
+// for the given type of fractal
+double maximumZoomFactor( const FractalType& type );
+
+// coordinates passed to the functor must be relative to the center of the view
+// for DoubleDoublePrecision and above; returns NULL for PerturbationPrecision;
+// the tolerance of cycle detection is based on the distance between pixels
+GeneratorCore::Functor* createFunctor( const FractalType& type, const Position& position, const QSize& resolution, Precision precision );
+
+GeneratorCore::ReferenceOrbit* createReferenceOrbit( const FractalType& type, const Position& position, int maxIterations,
+    const GeneratorCore::Cancellation* cancellation = NULL );
+GeneratorCore::Functor* createPerturbationFunctor( const FractalType& type, const GeneratorCore::ReferenceOrbit* orbit );
 
 #if defined( HAVE_SSE2 )
 
-GeneratorCore::FunctorSSE2* createFunctorSSE2( const FractalType& type );
+GeneratorCore::FunctorSSE2* createFunctorSSE2( const FractalType& type, double tolerance );
+GeneratorCore::FunctorSSE2* createFunctorSSE2( const FractalType& type, const Position& position, const QSize& resolution, Precision precision );
+
+#endif
+
+#if defined( HAVE_AVX2 )
+
+GeneratorCore::FunctorAVX2* createFunctorAVX2( const FractalType& type, double tolerance );
+GeneratorCore::FunctorAVX2* createFunctorAVX2( const FractalType& type, const Position& position, const QSize& resolution, Precision precision );
 
 #endif
 
@@ -65,20 +65,37 @@ QDataStream& operator >>( QDataStream& stream, FractalType& type )
     return stream;
 }
 
+void Position::moveCenter( const QPointF& offset )
+{
+    m_centerX += FixedPoint( offset.x() );
+    m_centerY += FixedPoint( offset.y() );
+}
+
 QDataStream& operator <<( QDataStream& stream, const Position& position )
 {
     return stream
-        << position.m_center
+        << position.center()
         << position.m_zoomFactor
-        << position.m_angle;
+        << position.m_angle
+        << position.m_centerX
+        << position.m_centerY;
 }
 
 QDataStream& operator >>( QDataStream& stream, Position& position )
 {
-    return stream
-        >> position.m_center
+    int version = fraqtive()->configuration()->dataVersion();
+
+    QPointF center;
+    stream >> center
         >> position.m_zoomFactor
         >> position.m_angle;
+
+    if ( version >= 3 )
+        stream >> position.m_centerX >> position.m_centerY;
+    else
+        position.setCenter( center );
+
+    return stream;
 }
 
 bool Gradient::isEmpty() const
@@ -124,14 +141,26 @@ QDataStream& operator <<( QDataStream& stream, const GeneratorSettings& settings
 {
     return stream
         << settings.m_calculationDepth
-        << settings.m_detailThreshold;
+        << settings.m_detailThreshold
+        << (qint8)settings.m_samplingMethod;
 }
 
 QDataStream& operator >>( QDataStream& stream, GeneratorSettings& settings )
 {
-    return stream
-        >> settings.m_calculationDepth
+    int version = fraqtive()->configuration()->dataVersion();
+
+    stream >> settings.m_calculationDepth
         >> settings.m_detailThreshold;
+
+    if ( version >= 4 ) {
+        qint8 method;
+        stream >> method;
+        settings.m_samplingMethod = (SamplingMethod)method;
+    } else {
+        settings.m_samplingMethod = GridSampling;
+    }
+
+    return stream;
 }
 
 QDataStream& operator <<( QDataStream& stream, const ViewSettings& settings )
@@ -24,6 +24,7 @@
 #include <QColor>
 
 #include "generatorcore.h"
+#include "fixedpoint.h"
 
 enum Fractal
 {
@@ -37,6 +38,16 @@ enum ExponentType
     RealExponent
 };
 
+// the arithmetic required to resolve the pixels of a view, from the fastest
+// to the most precise
+enum Precision
+{
+    SinglePrecision,
+    DoublePrecision,
+    DoubleDoublePrecision,
+    PerturbationPrecision
+};
+
 class FractalType
 {
 public:
@@ -106,8 +117,15 @@ public:
     Position();
 
 public:
-    void setCenter( const QPointF& center ) { m_center = center; }
-    QPointF center() const { return m_center; }
+    void setCenter( const QPointF& center ) { m_centerX = FixedPoint( center.x() ); m_centerY = FixedPoint( center.y() ); }
+    QPointF center() const { return QPointF( m_centerX.toDouble(), m_centerY.toDouble() ); }
+
+    // the exact center, which is necessary for zoom factors beyond about 13
+    void setCenter( const FixedPoint& x, const FixedPoint& y ) { m_centerX = x; m_centerY = y; }
+    const FixedPoint& centerX() const { return m_centerX; }
+    const FixedPoint& centerY() const { return m_centerY; }
+
+    void moveCenter( const QPointF& offset );
 
     void setZoomFactor( double factor ) { m_zoomFactor = factor; }
     double zoomFactor() const { return m_zoomFactor; }
@@ -123,7 +141,8 @@ public:
     friend bool operator !=( const Position& lhv, const Position& rhv ) { return !( lhv == rhv ); }
 
 private:
-    QPointF m_center;
+    FixedPoint m_centerX;
+    FixedPoint m_centerY;
     double m_zoomFactor; // log10
     double m_angle; // degrees
 };
@@ -136,7 +155,7 @@ inline Position::Position() :
 
 inline bool operator ==( const Position& lhv, const Position& rhv )
 {
-    return ( lhv.m_center.x() == rhv.m_center.x() && lhv.m_center.y() == rhv.m_center.y() ) // exact compare
+    return ( lhv.m_centerX == rhv.m_centerX && lhv.m_centerY == rhv.m_centerY ) // exact compare
         && qFuzzyCompare( lhv.m_zoomFactor, rhv.m_zoomFactor )
         && qFuzzyCompare( lhv.m_angle, rhv.m_angle );
 }
@@ -240,6 +259,15 @@ inline bool operator ==( const ColorMapping& lhv, const ColorMapping& rhv )
 
 Q_DECLARE_METATYPE( ColorMapping )
 
+// the method of choosing which points of a region are calculated
+enum SamplingMethod
+{
+    GridSampling,
+    RectangleSampling,
+    VerifiedRectangleSampling,
+    QuadtreeSampling
+};
+
 class GeneratorSettings
 {
 public:
@@ -252,6 +280,9 @@ public:
     void setDetailThreshold( double threshold ) { m_detailThreshold = threshold; }
     double detailThreshold() const { return m_detailThreshold; }
 
+    void setSamplingMethod( SamplingMethod method ) { m_samplingMethod = method; }
+    SamplingMethod samplingMethod() const { return m_samplingMethod; }
+
 public:
     friend QDataStream& operator <<( QDataStream& stream, const GeneratorSettings& settings );
     friend QDataStream& operator >>( QDataStream& stream, GeneratorSettings& settings );
@@ -262,18 +293,21 @@ public:
 private:
     double m_calculationDepth;
     double m_detailThreshold;
+    SamplingMethod m_samplingMethod;
 };
 
 inline GeneratorSettings::GeneratorSettings() :
     m_calculationDepth( 0.0 ),
-    m_detailThreshold( 0.0 )
+    m_detailThreshold( 0.0 ),
+    m_samplingMethod( GridSampling )
 {
 }
 
 inline bool operator ==( const GeneratorSettings& lhv, const GeneratorSettings& rhv )
 {
     return qFuzzyCompare( lhv.m_calculationDepth, rhv.m_calculationDepth )
-        && qFuzzyCompare( lhv.m_detailThreshold, rhv.m_detailThreshold );
+        && qFuzzyCompare( lhv.m_detailThreshold, rhv.m_detailThreshold )
+        && ( lhv.m_samplingMethod == rhv.m_samplingMethod );
 }
 
 Q_DECLARE_METATYPE( GeneratorSettings )
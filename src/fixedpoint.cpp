@@ -0,0 +1,205 @@
+/**************************************************************************
+* This file is part of the Fraqtive program
+* Copyright (C) 2004-2012 Michał Męciński
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include "fixedpoint.h"
+
+#include <QDataStream>
+
+#include <math.h>
+
+FixedPoint::FixedPoint() :
+    m_size( 1 )
+{
+    m_limbs[ 0 ] = 0;
+}
+
+FixedPoint::FixedPoint( double value ) :
+    m_size( 1 )
+{
+    double magnitude = qMin( fabs( value ), 2147483647.0 );
+
+    double integer = floor( magnitude );
+    m_limbs[ 0 ] = (quint32)integer;
+
+    // the conversion is exact, unless the value has bits below 2^-1248
+    double fraction = magnitude - integer;
+    while ( fraction != 0.0 && m_size < MaxSize ) {
+        fraction *= 4294967296.0;
+        double limb = floor( fraction );
+        m_limbs[ m_size++ ] = (quint32)limb;
+        fraction -= limb;
+    }
+
+    if ( value < 0.0 )
+        negate();
+}
+
+void FixedPoint::setSize( int size )
+{
+    size = qBound( 1, size, (int)MaxSize );
+    for ( int i = m_size; i < size; i++ )
+        m_limbs[ i ] = 0;
+    m_size = size;
+}
+
+int FixedPoint::sizeForBits( int bits )
+{
+    return qBound( 1, 1 + ( bits + 31 ) / 32, (int)MaxSize );
+}
+
+double FixedPoint::toDouble() const
+{
+    FixedPoint magnitude = isNegative() ? -*this : *this;
+
+    int first = 0;
+    while ( first < magnitude.m_size && magnitude.m_limbs[ first ] == 0 )
+        first++;
+
+    // only the three most significant non-zero limbs contribute to the result
+    double result = 0.0;
+    for ( int i = qMin( magnitude.m_size, first + 3 ) - 1; i >= first; i-- )
+        result = result / 4294967296.0 + (double)magnitude.m_limbs[ i ];
+
+    result = ldexp( result, -32 * first );
+
+    return isNegative() ? -result : result;
+}
+
+FixedPoint FixedPoint::operator -() const
+{
+    FixedPoint result = *this;
+    result.negate();
+    return result;
+}
+
+FixedPoint& FixedPoint::operator +=( const FixedPoint& other )
+{
+    if ( other.m_size > m_size )
+        setSize( other.m_size );
+
+    quint64 carry = 0;
+    for ( int i = m_size - 1; i >= 0; i-- ) {
+        quint64 sum = (quint64)m_limbs[ i ] + ( i < other.m_size ? other.m_limbs[ i ] : 0 ) + carry;
+        m_limbs[ i ] = (quint32)sum;
+        carry = sum >> 32;
+    }
+
+    return *this;
+}
+
+FixedPoint& FixedPoint::operator -=( const FixedPoint& other )
+{
+    return *this += -other;
+}
+
+FixedPoint operator +( const FixedPoint& lhv, const FixedPoint& rhv )
+{
+    FixedPoint result = lhv;
+    result += rhv;
+    return result;
+}
+
+FixedPoint operator -( const FixedPoint& lhv, const FixedPoint& rhv )
+{
+    FixedPoint result = lhv;
+    result -= rhv;
+    return result;
+}
+
+FixedPoint operator *( const FixedPoint& lhv, const FixedPoint& rhv )
+{
+    int size = qMax( lhv.m_size, rhv.m_size );
+
+    FixedPoint a = lhv.isNegative() ? -lhv : lhv;
+    FixedPoint b = rhv.isNegative() ? -rhv : rhv;
+    a.setSize( size );
+    b.setSize( size );
+
+    // multiply the magnitudes column by column, starting from one guard column
+    // below the precision of the result; the products below it are truncated
+    FixedPoint result;
+    result.m_size = size;
+
+    quint64 carry = 0;
+    for ( int k = size; k >= 0; k-- ) {
+        quint64 low = carry;
+        quint64 high = 0;
+        for ( int i = qMax( 0, k - size + 1 ); i <= qMin( k, size - 1 ); i++ ) {
+            quint64 product = (quint64)a.m_limbs[ i ] * b.m_limbs[ k - i ];
+            low += (quint32)product;
+            high += product >> 32;
+        }
+        if ( k < size )
+            result.m_limbs[ k ] = (quint32)low;
+        carry = ( low >> 32 ) + high;
+    }
+
+    if ( lhv.isNegative() != rhv.isNegative() )
+        result.negate();
+
+    return result;
+}
+
+bool operator ==( const FixedPoint& lhv, const FixedPoint& rhv )
+{
+    int size = qMax( lhv.m_size, rhv.m_size );
+    for ( int i = 0; i < size; i++ ) {
+        quint32 l = i < lhv.m_size ? lhv.m_limbs[ i ] : 0;
+        quint32 r = i < rhv.m_size ? rhv.m_limbs[ i ] : 0;
+        if ( l != r )
+            return false;
+    }
+    return true;
+}
+
+void FixedPoint::negate()
+{
+    quint64 carry = 1;
+    for ( int i = m_size - 1; i >= 0; i-- ) {
+        quint64 sum = (quint64)(quint32)~m_limbs[ i ] + carry;
+        m_limbs[ i ] = (quint32)sum;
+        carry = sum >> 32;
+    }
+}
+
+QDataStream& operator <<( QDataStream& stream, const FixedPoint& value )
+{
+    stream << (qint32)value.m_size;
+    for ( int i = 0; i < value.m_size; i++ )
+        stream << value.m_limbs[ i ];
+    return stream;
+}
+
+QDataStream& operator >>( QDataStream& stream, FixedPoint& value )
+{
+    qint32 size;
+    stream >> size;
+
+    value = FixedPoint();
+
+    for ( int i = 0; i < size; i++ ) {
+        quint32 limb;
+        stream >> limb;
+        if ( i < FixedPoint::MaxSize )
+            value.m_limbs[ i ] = limb;
+    }
+
+    value.m_size = qBound( 1, (int)size, (int)FixedPoint::MaxSize );
+
+    return stream;
+}
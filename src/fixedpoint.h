@@ -0,0 +1,71 @@
+/**************************************************************************
+* This file is part of the Fraqtive program
+* Copyright (C) 2004-2012 Michał Męciński
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef FIXEDPOINT_H
+#define FIXEDPOINT_H
+
+#include <qglobal.h>
+
+class QDataStream;
+
+// a signed fixed point number with a 32-bit integer part and a variable number
+// of 32-bit fractional limbs, stored in two's complement, most significant limb
+// first; the result of an operation has the precision of the more precise operand
+class FixedPoint
+{
+public:
+    static const int MaxSize = 40; // 1248 bits, enough for a zoom factor of about 370
+
+public:
+    FixedPoint();
+    FixedPoint( double value );
+
+public:
+    int size() const { return m_size; }
+    void setSize( int size );
+
+    static int sizeForBits( int bits );
+
+    bool isNegative() const { return ( m_limbs[ 0 ] & 0x80000000 ) != 0; }
+
+    double toDouble() const;
+
+    FixedPoint operator -() const;
+
+    FixedPoint& operator +=( const FixedPoint& other );
+    FixedPoint& operator -=( const FixedPoint& other );
+
+    friend FixedPoint operator +( const FixedPoint& lhv, const FixedPoint& rhv );
+    friend FixedPoint operator -( const FixedPoint& lhv, const FixedPoint& rhv );
+    friend FixedPoint operator *( const FixedPoint& lhv, const FixedPoint& rhv );
+
+    friend bool operator ==( const FixedPoint& lhv, const FixedPoint& rhv );
+    friend bool operator !=( const FixedPoint& lhv, const FixedPoint& rhv ) { return !( lhv == rhv ); }
+
+    friend QDataStream& operator <<( QDataStream& stream, const FixedPoint& value );
+    friend QDataStream& operator >>( QDataStream& stream, FixedPoint& value );
+
+private:
+    void negate();
+
+private:
+    int m_size;
+    quint32 m_limbs[ MaxSize ];
+};
+
+#endif
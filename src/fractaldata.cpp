@@ -41,6 +41,7 @@ void FractalData::clear()
     m_stride = 0;
     m_size = QSize();
     m_validRegions.clear();
+    m_coarseRegions.clear();
 }
 
 void FractalData::setBuffer( double* buffer, int stride, const QSize& size )
@@ -53,6 +54,7 @@ void FractalData::setBuffer( double* buffer, int stride, const QSize& size )
     m_stride = stride;
     m_size = size;
     m_validRegions.clear();
+    m_coarseRegions.clear();
 }
 
 void FractalData::transferBuffer( double* buffer, int stride, const QSize& size )
@@ -65,6 +67,7 @@ void FractalData::transferBuffer( double* buffer, int stride, const QSize& size
     m_stride = stride;
     m_size = size;
     m_validRegions.clear();
+    m_coarseRegions.clear();
 }
 
 void FractalData::setValidRegion( const QRect& region )
@@ -77,3 +80,8 @@ void FractalData::setValidRegions( const QList<QRect>& regions )
 {
     m_validRegions = regions;
 }
+
+void FractalData::setCoarseRegions( const QList<QRect>& regions )
+{
+    m_coarseRegions = regions;
+}
@@ -42,6 +42,11 @@ public:
 
     QList<QRect> validRegions() const { return m_validRegions; }
 
+    // regions which only contain the interpolated preview grid
+    void setCoarseRegions( const QList<QRect>& regions );
+
+    QList<QRect> coarseRegions() const { return m_coarseRegions; }
+
 private:
     double* m_buffer;
     bool m_owner;
@@ -50,6 +55,7 @@ private:
     QSize m_size;
 
     QList<QRect> m_validRegions;
+    QList<QRect> m_coarseRegions;
 };
 
 #endif
@@ -18,7 +18,12 @@
 
 #include "fractalgenerator.h"
 
+#include <QRegion>
+#include <QtAlgorithms>
+
 #include <math.h>
+#include <string.h>
+#include <limits.h>
 
 #ifndef M_PI
 # define M_PI 3.14159265358979323846
@@ -31,14 +36,32 @@
 
 FractalGenerator::FractalGenerator( QObject* parent ) : QObject( parent ),
     m_preview( false ),
+    m_progressive( false ),
+    m_continuationLimit( 0 ),
     m_priority( 0 ),
     m_receiver( NULL ),
     m_enabled( false ),
+    m_focused( false ),
     m_functor( NULL ),
 #if defined( HAVE_SSE2 )
     m_functorSSE2( NULL ),
 #endif
+#if defined( HAVE_AVX2 )
+    m_functorAVX2( NULL ),
+#endif
+    m_precision( DoublePrecision ),
+    m_orbit( NULL ),
+    m_orbitPending( false ),
     m_buffer( NULL ),
+    m_known( NULL ),
+    m_pass( FullPass ),
+    m_batchCost( 0.0 ),
+    m_tileCacheSize( 0 ),
+    m_tileCache( NULL ),
+    m_layer( -1 ),
+    m_baseLayer( -1 ),
+    m_baseThreshold( 0.0 ),
+    m_continuation( NULL ),
     m_activeJobs( 0 ),
     m_pending( false ),
     m_update( NoUpdate ),
@@ -60,9 +83,21 @@ FractalGenerator::~FractalGenerator()
 #if defined( HAVE_SSE2 )
     delete m_functorSSE2;
 #endif
+#if defined( HAVE_AVX2 )
+    delete m_functorAVX2;
+#endif
+
+    delete m_orbit;
 
     delete[] m_buffer;
+    delete[] m_known;
     delete[] m_previewBuffer;
+
+    qDeleteAll( m_tiles );
+    delete m_tileCache;
+
+    delete m_continuation;
+    qDeleteAll( m_resumed );
 }
 
 void FractalGenerator::setPreviewMode( bool preview )
@@ -70,6 +105,32 @@ void FractalGenerator::setPreviewMode( bool preview )
     m_preview = preview;
 }
 
+void FractalGenerator::setProgressiveMode( bool progressive )
+{
+    m_progressive = progressive;
+}
+
+// index, zx, zy, iterations and reference of a point
+static const int ContinuationPointSize = 3 * sizeof( int ) + 2 * sizeof( double );
+
+void FractalGenerator::setResumableMemory( int size )
+{
+    QMutexLocker locker( &m_mutex );
+
+    m_continuationLimit = (int)qMin( (qint64)qMax( size, 0 ) * 1024 * 1024 / ContinuationPointSize, (qint64)INT_MAX );
+}
+
+void FractalGenerator::setTileCacheSize( int size )
+{
+    QMutexLocker locker( &m_mutex );
+
+    if ( !m_tileCache )
+        m_tileCache = new TileCache();
+
+    m_tileCache->setCapacity( size );
+    m_tileCacheSize = size;
+}
+
 void FractalGenerator::setPriority( int priority )
 {
     m_priority = priority;
@@ -147,7 +208,9 @@ void FractalGenerator::setGeneratorSettings( const GeneratorSettings& settings )
     handleState();
 }
 
-static const int CellsPerRegion = 8;
+// the regions are square blocks of 64 x 64 points, like the tiles, so that
+// the points of a region fit in the cache of the processor
+static const int CellsPerRegion = 21;
 static const int RegionSize = CellsPerRegion * GeneratorCore::CellSize + 1;
 
 static int roundToCellSize( int size )
@@ -156,17 +219,21 @@ static int roundToCellSize( int size )
     return ( ( size - 1 + GeneratorCore::CellSize - 1 ) / GeneratorCore::CellSize ) * GeneratorCore::CellSize + 1;
 }
 
+static int roundToRegionSize( int size )
+{
+    // the last region is smaller, but it must also be N * CellSize + 1
+    int fullRegions = size / RegionSize;
+    int remainder = size - fullRegions * RegionSize;
+
+    return fullRegions * RegionSize + ( ( remainder > 0 ) ? roundToCellSize( remainder ) : 0 );
+}
+
 void FractalGenerator::setResolution( const QSize& resolution )
 {
     QMutexLocker locker( &m_mutex );
 
-    int fullRegions = resolution.height() / RegionSize;
-    int remainder = resolution.height() - fullRegions * RegionSize;
-
-    int width = roundToCellSize( resolution.width() );
-    int height = fullRegions * RegionSize;
-    if ( remainder > 0 )
-        height += roundToCellSize( remainder );
+    int width = roundToRegionSize( resolution.width() );
+    int height = roundToRegionSize( resolution.height() );
 
     m_pendingResolution = resolution;
     m_pendingBufferSize = QSize( width, height );
@@ -177,6 +244,31 @@ void FractalGenerator::setResolution( const QSize& resolution )
     handleState();
 }
 
+void FractalGenerator::setFocusPoint( const QPointF& point )
+{
+    QMutexLocker locker( &m_mutex );
+
+    // the order only changes noticeably when the cursor enters another block
+    QPoint block( (int)floor( point.x() / RegionSize ), (int)floor( point.y() / RegionSize ) );
+    bool changed = !m_focused || block != m_focusBlock;
+
+    m_focused = true;
+    m_focusPoint = point;
+    m_focusBlock = block;
+
+    if ( changed )
+        sortRegions();
+}
+
+void FractalGenerator::clearFocusPoint()
+{
+    QMutexLocker locker( &m_mutex );
+
+    m_focused = false;
+
+    sortRegions();
+}
+
 int FractalGenerator::maximumIterations() const
 {
     return (int)( pow( 10.0, m_settings.calculationDepth() ) * qMax( 1.0, 1.45 + m_position.zoomFactor() ) );
@@ -193,12 +285,14 @@ FractalGenerator::UpdateStatus FractalGenerator::updateData( FractalData* data )
         case InitialUpdate:
             data->setBuffer( m_buffer, m_bufferSize.width(), m_resolution );
             data->setValidRegions( m_validRegions );
+            data->setCoarseRegions( m_coarseRegions );
             break;
 
         case PartialUpdate:
             if ( data->isEmpty() )
                 return NoUpdate;
             data->setValidRegions( m_validRegions );
+            data->setCoarseRegions( m_coarseRegions );
             break;
 
         case FullUpdate:
@@ -227,13 +321,112 @@ void FractalGenerator::executeJob()
 {
     QMutexLocker locker( &m_mutex );
 
-    if ( m_enabled && m_regions.count() > 0 )
-        calculateRegion( m_regions.takeFirst() );
+    if ( m_enabled && m_orbitPending )
+        calculateOrbit();
+    else if ( m_enabled && m_regions.count() > 0 && m_pass == CoarsePass )
+        calculateCoarseRegion( m_regions.takeFirst() );
+    else if ( m_enabled && m_regions.count() > 0 ) {
+        // cheap regions are calculated together to reduce the overhead of jobs
+        double cost = 0.0;
+        calculateRegion( takeRegion( &cost ) );
+        while ( m_enabled && !m_pending && !m_regionCosts.isEmpty() && cost + m_regionCosts.first() <= m_batchCost )
+            calculateRegion( takeRegion( &cost ) );
+    }
 
     finishJob();
     handleState();
 }
 
+void FractalGenerator::calculateOrbit()
+{
+    int maxIterations = maximumIterations();
+
+    m_mutex.unlock();
+
+    GeneratorCore::ReferenceOrbit* orbit = DataFunctions::createReferenceOrbit( m_type, m_position, maxIterations, &m_cancellation );
+
+    m_mutex.lock();
+
+    // the orbit is out of date if parameters were changed in the meantime;
+    // when it was cancelled, it's calculated again by the next job
+    if ( !orbit || m_pending ) {
+        delete orbit;
+        return;
+    }
+
+    m_orbit = orbit;
+    m_orbitPending = false;
+
+    m_functor = DataFunctions::createPerturbationFunctor( m_type, m_orbit );
+    if ( m_functor != NULL )
+        m_functor->setCancellation( &m_cancellation );
+}
+
+void FractalGenerator::calculateCoarseRegion( const QRect& region )
+{
+    GeneratorCore::Input input;
+    calculateInput( &input, region );
+
+    GeneratorCore::Output output;
+    calculateOutput( &output, region );
+
+    // only the grid sampling uses the points of the preview later
+    GeneratorCore::Continuation* continuation = NULL;
+    if ( m_continuation && m_settings.samplingMethod() == GridSampling )
+        continuation = new GeneratorCore::Continuation();
+    output.m_continuation = continuation;
+
+    // the points of the zoomed tiles are reused
+    bool* known = NULL;
+    if ( m_layer >= 0 && m_known ) {
+        known = copyKnownTile( region, output );
+        output.m_known = known;
+    }
+
+    int maxIterations = maximumIterations();
+
+    m_mutex.unlock();
+
+#if defined( HAVE_AVX2 )
+    if ( m_functorAVX2 )
+        GeneratorCore::generatePreviewAVX2( input, output, m_functorAVX2, maxIterations );
+    else
+#endif
+#if defined( HAVE_SSE2 )
+    if ( m_functorSSE2 )
+        GeneratorCore::generatePreviewSSE2( input, output, m_functorSSE2, maxIterations );
+    else
+#endif
+    if ( m_functor )
+        GeneratorCore::generatePreview( input, output, m_functor, maxIterations );
+
+    GeneratorCore::interpolate( output );
+
+    m_mutex.lock();
+
+    delete[] known;
+
+    // the output is incomplete, so the view is calculated again
+    if ( m_cancellation.isCancelled() ) {
+        delete continuation;
+        m_pending = true;
+        return;
+    }
+
+    if ( continuation ) {
+        storeContinuation( continuation, region, output.m_stride );
+        delete continuation;
+    }
+
+    if ( m_layer >= 0 )
+        storeTile( region, false );
+
+    appendRegion( &m_coarseRegions, region );
+
+    if ( m_update == NoUpdate )
+        postUpdate( PartialUpdate );
+}
+
 void FractalGenerator::calculateRegion( const QRect& region )
 {
     GeneratorCore::Input input;
@@ -242,27 +435,113 @@ void FractalGenerator::calculateRegion( const QRect& region )
     GeneratorCore::Output output;
     calculateOutput( &output, region );
 
+    GeneratorCore::Continuation* continuation = NULL;
+    if ( m_continuation )
+        continuation = new GeneratorCore::Continuation();
+    output.m_continuation = continuation;
+
+    // the points which didn't escape in the previous view
+    GeneratorCore::Continuation* resumed = m_resumed.take( qMakePair( region.left(), region.top() ) );
+
+    // the tile with the previous detail threshold is refined, or the points
+    // of the zoomed tiles are reused
+    bool* known = NULL;
+    if ( m_layer >= 0 && m_baseLayer >= 0 ) {
+        known = copyBaseTile( region, output );
+        output.m_known = known;
+    } else if ( m_layer >= 0 && m_known ) {
+        known = copyKnownTile( region, output );
+        output.m_known = known;
+    }
+
+    bool shared = m_sharedColumns.contains( qMakePair( region.left(), region.top() ) );
+    if ( shared ) {
+        known = markSharedColumn( output );
+        output.m_known = known;
+    }
+
     int maxIterations = maximumIterations();
     double threshold = m_settings.detailThreshold();
+    SamplingMethod method = m_settings.samplingMethod();
+    bool verify = ( method == VerifiedRectangleSampling );
+
+    // the preview grid is already calculated in the refinement pass
+    bool refine = ( m_pass == RefinementPass );
 
     m_mutex.unlock();
 
+    if ( resumed )
+        resumeRegion( region, input, output, resumed, maxIterations );
+
+#if defined( HAVE_AVX2 )
+    if ( m_functorAVX2 ) {
+        if ( method == GridSampling ) {
+            if ( !refine ) {
+                GeneratorCore::generatePreviewAVX2( input, output, m_functorAVX2, maxIterations );
+                GeneratorCore::interpolate( output );
+            }
+            GeneratorCore::generateDetailsAVX2( input, output, m_functorAVX2, maxIterations, threshold );
+        } else if ( method == QuadtreeSampling ) {
+            GeneratorCore::generateQuadtreeAVX2( input, output, m_functorAVX2, maxIterations, threshold );
+        } else {
+            GeneratorCore::generateRectanglesAVX2( input, output, m_functorAVX2, maxIterations, threshold, verify );
+        }
+    } else
+#endif
 #if defined( HAVE_SSE2 )
     if ( m_functorSSE2 ) {
-        GeneratorCore::generatePreviewSSE2( input, output, m_functorSSE2, maxIterations );
-        GeneratorCore::interpolate( output );
-        GeneratorCore::generateDetailsSSE2( input, output, m_functorSSE2, maxIterations, threshold );
+        if ( method == GridSampling ) {
+            if ( !refine ) {
+                GeneratorCore::generatePreviewSSE2( input, output, m_functorSSE2, maxIterations );
+                GeneratorCore::interpolate( output );
+            }
+            GeneratorCore::generateDetailsSSE2( input, output, m_functorSSE2, maxIterations, threshold );
+        } else if ( method == QuadtreeSampling ) {
+            GeneratorCore::generateQuadtreeSSE2( input, output, m_functorSSE2, maxIterations, threshold );
+        } else {
+            GeneratorCore::generateRectanglesSSE2( input, output, m_functorSSE2, maxIterations, threshold, verify );
+        }
     } else
 #endif
     if ( m_functor ) {
-        GeneratorCore::generatePreview( input, output, m_functor, maxIterations );
-        GeneratorCore::interpolate( output );
-        GeneratorCore::generateDetails( input, output, m_functor, maxIterations, threshold );
+        if ( method == GridSampling ) {
+            if ( !refine ) {
+                GeneratorCore::generatePreview( input, output, m_functor, maxIterations );
+                GeneratorCore::interpolate( output );
+            }
+            GeneratorCore::generateDetails( input, output, m_functor, maxIterations, threshold );
+        } else if ( method == QuadtreeSampling ) {
+            GeneratorCore::generateQuadtree( input, output, m_functor, maxIterations, threshold );
+        } else {
+            GeneratorCore::generateRectangles( input, output, m_functor, maxIterations, threshold, verify );
+        }
     }
 
     m_mutex.lock();
 
-    appendValidRegion( region );
+    delete resumed;
+    delete[] known;
+
+    // the output is incomplete and the resumed points were marked as known,
+    // so the view is calculated again
+    if ( m_cancellation.isCancelled() ) {
+        delete continuation;
+        m_pending = true;
+        return;
+    }
+
+    if ( continuation ) {
+        storeContinuation( continuation, region, output.m_stride );
+        delete continuation;
+    }
+
+    if ( m_layer >= 0 )
+        storeTile( region, true );
+    else if ( method == GridSampling )
+        m_gridRegions.append( region );
+
+    // the shared column is valid when the region on the left is calculated
+    appendRegion( &m_validRegions, shared ? region.adjusted( 1, 0, 0, 0 ) : region );
 
     if ( !m_preview && m_update == NoUpdate )
         postUpdate( PartialUpdate );
@@ -274,6 +553,18 @@ void FractalGenerator::reset()
     cancelJobs();
 }
 
+static bool isDepthIncreased( const GeneratorSettings& from, const GeneratorSettings& to )
+{
+    return to.calculationDepth() > from.calculationDepth() && qFuzzyCompare( to.detailThreshold(), from.detailThreshold() )
+        && to.samplingMethod() == from.samplingMethod();
+}
+
+static bool isThresholdChanged( const GeneratorSettings& from, const GeneratorSettings& to )
+{
+    return !qFuzzyCompare( to.detailThreshold(), from.detailThreshold() ) && qFuzzyCompare( to.calculationDepth(), from.calculationDepth() )
+        && to.samplingMethod() == GridSampling && from.samplingMethod() == GridSampling;
+}
+
 void FractalGenerator::handleState()
 {
     if ( m_activeJobs > 0 || !m_enabled || m_pendingResolution.isEmpty() )
@@ -284,6 +575,14 @@ void FractalGenerator::handleState()
         return;
     }
 
+    // all regions have a preview, so the details can be calculated
+    if ( m_pass == CoarsePass && !m_pending ) {
+        m_pass = RefinementPass;
+        splitRegions();
+        addJobs();
+        return;
+    }
+
     if ( m_preview && m_buffer && m_regions.isEmpty() && m_resolution == m_pendingResolution ) {
         delete[] m_previewBuffer;
         m_previewBuffer = m_buffer;
@@ -293,6 +592,35 @@ void FractalGenerator::handleState()
     }
 
     if ( m_pending ) {
+        // when only the calculation depth is increased, the points which
+        // didn't escape are iterated further
+        bool resume = m_continuation && m_buffer && m_bufferSize == m_pendingBufferSize && m_resolution == m_pendingResolution
+            && m_type == m_pendingType && m_position == m_pendingPosition && isDepthIncreased( m_settings, m_pendingSettings );
+        int maxIterations = maximumIterations();
+
+        // when only the detail threshold is changed, the preview grid and the
+        // details which exceed both thresholds are kept
+        bool refine = m_buffer && !m_preview && m_bufferSize == m_pendingBufferSize && m_resolution == m_pendingResolution
+            && m_type == m_pendingType && m_position == m_pendingPosition && isThresholdChanged( m_settings, m_pendingSettings );
+        double threshold = qMax( m_settings.detailThreshold(), m_pendingSettings.detailThreshold() );
+        int layer = m_layer;
+
+        // unrotated views are assembled from cached tiles
+        bool tiled = !resume && m_tileCacheSize > 0 && !m_preview && qFuzzyIsNull( m_pendingPosition.angle() );
+
+        // when the view is moved by whole pixels or zoomed by a factor of two, the
+        // calculated points are reused instead of being calculated again; tiles of
+        // the same layer are already cached, so only the zoom is reused for them
+        int step = 0;
+        QPoint offset;
+        bool reuse = !resume && m_buffer && !m_preview && m_bufferSize == m_pendingBufferSize && m_resolution == m_pendingResolution
+            && m_type == m_pendingType && m_settings == m_pendingSettings
+            && ( tiled ? ( layer >= 0 && calculateZoomStep( &step ) && step != 0 ) : calculateMapping( &step, &offset ) );
+        QPoint origin = m_tileOrigin;
+
+        delete[] m_known;
+        m_known = NULL;
+
         if ( m_buffer && m_bufferSize != m_pendingBufferSize ) {
             delete[] m_buffer;
             m_buffer = NULL;
@@ -313,7 +641,53 @@ void FractalGenerator::handleState()
         if ( !m_preview )
             postUpdate( InitialUpdate );
 
-        m_validRegions.clear();
+        qDeleteAll( m_tiles );
+        m_tiles.clear();
+
+        qDeleteAll( m_resumed );
+        m_resumed.clear();
+
+        // the resumed and refined points keep the alignment of the previous view
+        if ( tiled ) {
+            setupTiles( ( refine || reuse ) ? layer : -1, refine );
+            m_baseThreshold = threshold;
+
+            // the point u of the previous layer is the point 2u of the layer
+            // zoomed in by a factor of two, when both have the same anchor
+            if ( reuse && m_tileCache->layerAnchor( m_layer ) == m_tileCache->layerAnchor( layer ) )
+                offset = ( step > 0 ) ? m_tileOrigin - 2 * origin : 2 * m_tileOrigin - origin;
+            else
+                reuse = false;
+        } else {
+            m_layer = -1;
+            m_baseLayer = -1;
+            if ( !resume && !refine )
+                m_phase = QPointF();
+        }
+
+        m_coarseRegions.clear();
+
+        GeneratorCore::Continuation* continuation = m_continuation;
+        m_continuation = ( m_continuationLimit > 0 && !m_preview ) ? new GeneratorCore::Continuation() : NULL;
+
+        if ( resume )
+            resumeBuffer( continuation, maxIterations );
+        else if ( refine )
+            refineBuffer( continuation, threshold );
+        else if ( reuse && step == 0 )
+            shiftBuffer( offset );
+        else if ( reuse )
+            zoomBuffer( step, offset );
+        else
+            m_validRegions.clear();
+
+        delete continuation;
+
+        m_gridRegions.clear();
+
+        // in progressive mode the whole view is first calculated using
+        // the preview grid and then the details of each region are added
+        m_pass = ( m_progressive && !m_preview && !resume && !refine ) ? CoarsePass : FullPass;
 
         splitRegions();
         addJobs();
@@ -325,31 +699,656 @@ void FractalGenerator::createFunctor()
     delete m_functor;
     m_functor = NULL;
 
+    delete m_orbit;
+    m_orbit = NULL;
+
 #if defined( HAVE_SSE2 )
     delete m_functorSSE2;
-    m_functorSSE2 = DataFunctions::createFunctorSSE2( m_type );
-    if ( m_functorSSE2 != NULL )
+    m_functorSSE2 = NULL;
+#endif
+
+#if defined( HAVE_AVX2 )
+    delete m_functorAVX2;
+    m_functorAVX2 = NULL;
+#endif
+
+    m_precision = DataFunctions::requiredPrecision( m_type, m_position, m_resolution );
+
+    // the perturbation functor is created after calculating the orbit
+    m_orbitPending = ( m_precision == PerturbationPrecision );
+    if ( m_orbitPending )
+        return;
+
+#if defined( HAVE_AVX2 )
+    m_functorAVX2 = DataFunctions::createFunctorAVX2( m_type, m_position, m_resolution, m_precision );
+    if ( m_functorAVX2 != NULL ) {
+        m_functorAVX2->setCancellation( &m_cancellation );
+        return;
+    }
+#endif
+
+#if defined( HAVE_SSE2 )
+    m_functorSSE2 = DataFunctions::createFunctorSSE2( m_type, m_position, m_resolution, m_precision );
+    if ( m_functorSSE2 != NULL ) {
+        m_functorSSE2->setCancellation( &m_cancellation );
         return;
+    }
 #endif
 
-    m_functor = DataFunctions::createFunctor( m_type );
+    m_functor = DataFunctions::createFunctor( m_type, m_position, m_resolution, m_precision );
+    if ( m_functor != NULL )
+        m_functor->setCancellation( &m_cancellation );
 }
 
+// the step is 1 when zooming in by a factor of two, -1 when zooming out and 0
+// when the zoom is not changed; the angle cannot be changed
+bool FractalGenerator::calculateZoomStep( int* step )
+{
+    double zoom = ( m_pendingPosition.zoomFactor() - m_position.zoomFactor() ) / log10( 2.0 );
+
+    int zoomStep = qRound( zoom );
+    if ( qAbs( zoom - zoomStep ) > 1e-9 || qAbs( zoomStep ) > 1 || qAbs( m_pendingPosition.angle() - m_position.angle() ) > 1e-9 )
+        return false;
+
+    *step = zoomStep;
+    return true;
+}
+
+// the point ( x, y ) of the pending position is the point ( x + offset.x(), y + offset.y() )
+// of the buffer when step is 0, the point ( ( x + offset.x() ) / 2, ( y + offset.y() ) / 2 )
+// when zooming in by a factor of two and ( 2 * x + offset.x(), 2 * y + offset.y() ) when
+// zooming out by a factor of two
+bool FractalGenerator::calculateMapping( int* step, QPoint* offset )
+{
+    int zoomStep;
+    if ( !calculateZoomStep( &zoomStep ) )
+        return false;
+
+    double scale = pow( 10.0, -m_position.zoomFactor() ) / (double)m_resolution.height();
+
+    double sa = scale * sin( m_position.angle() * M_PI / 180.0 );
+    double ca = scale * cos( m_position.angle() * M_PI / 180.0 );
+
+    double dx = ( m_pendingPosition.centerX() - m_position.centerX() ).toDouble();
+    double dy = ( m_pendingPosition.centerY() - m_position.centerY() ).toDouble();
+
+    // the offset in pixels is the inverse of the transformation in calculateInput()
+    double offsetX = ( ca * dx - sa * dy ) / ( scale * scale );
+    double offsetY = ( sa * dx + ca * dy ) / ( scale * scale );
+
+    if ( qAbs( offsetX ) >= m_resolution.width() || qAbs( offsetY ) >= m_resolution.height() )
+        return false;
+
+    // the zoom is relative to the center of the view
+    double centerX = (double)m_resolution.width() / 2.0 + 0.5;
+    double centerY = (double)m_resolution.height() / 2.0 + 0.5;
+
+    if ( zoomStep > 0 ) {
+        offsetX = centerX + 2.0 * offsetX;
+        offsetY = centerY + 2.0 * offsetY;
+    } else if ( zoomStep < 0 ) {
+        offsetX = offsetX - centerX;
+        offsetY = offsetY - centerY;
+    }
+
+    int x = qRound( offsetX );
+    int y = qRound( offsetY );
+
+    // a fraction of a pixel would displace all points of the buffer
+    if ( qAbs( offsetX - x ) > 1e-3 || qAbs( offsetY - y ) > 1e-3 )
+        return false;
+
+    *step = zoomStep;
+    *offset = QPoint( x, y );
+    return true;
+}
+
+void FractalGenerator::shiftBuffer( const QPoint& shift )
+{
+    int width = m_bufferSize.width();
+    int height = m_bufferSize.height();
+
+    // the point at ( x, y ) is moved from ( x + shift.x(), y + shift.y() )
+    int left = qMax( -shift.x(), 0 );
+    int count = width - qAbs( shift.x() );
+
+    if ( shift.y() <= 0 ) {
+        for ( int y = height - 1; y >= -shift.y(); y-- ) {
+            double* row = m_buffer + y * width;
+            memmove( row + left, row + shift.y() * width + left + shift.x(), count * sizeof( double ) );
+        }
+    } else {
+        for ( int y = 0; y < height - shift.y(); y++ ) {
+            double* row = m_buffer + y * width;
+            memmove( row + left, row + shift.y() * width + left + shift.x(), count * sizeof( double ) );
+        }
+    }
+
+    QList<QRect> regions = m_validRegions;
+    m_validRegions.clear();
+
+    for ( int i = 0; i < regions.count(); i++ )
+        appendRegion( &m_validRegions, regions[ i ].translated( -shift ) );
+}
+
+static int divideFloor( int value, int divisor )
+{
+    return ( value >= 0 ) ? value / divisor : -( ( -value + divisor - 1 ) / divisor );
+}
+
+static int divideCeil( int value, int divisor )
+{
+    return -divideFloor( -value, divisor );
+}
+
+void FractalGenerator::zoomBuffer( int step, const QPoint& offset )
+{
+    int width = m_bufferSize.width();
+    int height = m_bufferSize.height();
+
+    double* source = new double[ width * height ];
+    memcpy( source, m_buffer, width * height * sizeof( double ) );
+
+    m_known = new bool[ width * height ];
+    for ( int i = 0; i < width * height; i++ )
+        m_known[ i ] = false;
+
+    QList<QRect> regions = m_validRegions;
+    m_validRegions.clear();
+
+    QRect visible( QPoint( 0, 0 ), m_resolution );
+
+    for ( int i = 0; i < regions.count(); i++ ) {
+        // tiles may exceed the view and are only copied to its visible part
+        QRect from = regions[ i ].intersected( visible );
+        if ( from.isEmpty() )
+            continue;
+
+        if ( step > 0 ) {
+            // every other point of every other row of the enlarged region
+            QRect to = QRect( QPoint( 2 * from.left() - offset.x(), 2 * from.top() - offset.y() ),
+                QPoint( 2 * from.right() - offset.x(), 2 * from.bottom() - offset.y() ) ).intersected( visible );
+
+            for ( int y = to.top() + ( ( to.top() + offset.y() ) & 1 ); y <= to.bottom(); y += 2 ) {
+                const double* src = source + ( ( y + offset.y() ) / 2 ) * width;
+                for ( int x = to.left() + ( ( to.left() + offset.x() ) & 1 ); x <= to.right(); x += 2 ) {
+                    m_buffer[ y * width + x ] = src[ ( x + offset.x() ) / 2 ];
+                    m_known[ y * width + x ] = true;
+                }
+            }
+        } else {
+            // every point of the reduced region
+            QRect to = QRect( QPoint( divideCeil( from.left() - offset.x(), 2 ), divideCeil( from.top() - offset.y(), 2 ) ),
+                QPoint( divideFloor( from.right() - offset.x(), 2 ), divideFloor( from.bottom() - offset.y(), 2 ) ) ).intersected( visible );
+
+            for ( int y = to.top(); y <= to.bottom(); y++ ) {
+                const double* src = source + ( 2 * y + offset.y() ) * width;
+                for ( int x = to.left(); x <= to.right(); x++ ) {
+                    m_buffer[ y * width + x ] = src[ 2 * x + offset.x() ];
+                    m_known[ y * width + x ] = true;
+                }
+            }
+
+            if ( !to.isEmpty() )
+                appendRegion( &m_validRegions, to );
+        }
+    }
+
+    delete[] source;
+}
+
+void FractalGenerator::resumeBuffer( const GeneratorCore::Continuation* continuation, int maxIterations )
+{
+    int stride = m_bufferSize.width();
+    int size = stride * m_bufferSize.height();
+
+    m_known = new bool[ size ];
+    for ( int i = 0; i < size; i++ )
+        m_known[ i ] = false;
+
+    // the points which escaped remain the same
+    for ( int i = 0; i < m_validRegions.count(); i++ ) {
+        const QRect& rect = m_validRegions[ i ];
+        for ( int y = rect.top(); y <= rect.bottom(); y++ ) {
+            for ( int x = rect.left(); x <= rect.right(); x++ )
+                m_known[ y * stride + x ] = m_buffer[ y * stride + x ] != 0.0;
+        }
+    }
+
+    const int* indexes = continuation->indexes();
+    GeneratorCore::IterationState state = continuation->state();
+
+    for ( int i = 0; i < continuation->count(); i++ ) {
+        int index = indexes[ i ];
+
+        // so do periodic points
+        if ( state.m_iterations[ i ] < maxIterations ) {
+            m_known[ index ] = true;
+            continue;
+        }
+
+        // the other points are resumed by the region which contains them
+        int left = index % stride / RegionSize * RegionSize;
+        int top = index / stride / RegionSize * RegionSize;
+        GeneratorCore::Continuation*& resumed = m_resumed[ qMakePair( left, top ) ];
+        if ( !resumed )
+            resumed = new GeneratorCore::Continuation();
+        resumed->append( index - top * stride - left, state.m_zx[ i ], state.m_zy[ i ], state.m_iterations[ i ], state.m_reference[ i ] );
+    }
+
+    // the previous image is displayed until the regions are calculated again
+    m_coarseRegions = m_validRegions;
+    m_validRegions.clear();
+}
+
+void FractalGenerator::refineBuffer( const GeneratorCore::Continuation* continuation, double threshold )
+{
+    // the tiles are refined when they are calculated
+    if ( m_layer < 0 ) {
+        int stride = m_bufferSize.width();
+        int size = stride * m_bufferSize.height();
+
+        m_known = new bool[ size ];
+        for ( int i = 0; i < size; i++ )
+            m_known[ i ] = false;
+
+        // only the regions calculated using the grid of the current blocks are kept
+        for ( int i = 0; i < m_gridRegions.count(); i++ ) {
+            const QRect& region = m_gridRegions[ i ];
+
+            GeneratorCore::Output output;
+            calculateOutput( &output, region );
+
+            GeneratorCore::markDetails( output, threshold, m_known + region.top() * stride + region.left() );
+        }
+
+        // the state of the points which are kept remains valid
+        if ( continuation && m_continuation ) {
+            const int* indexes = continuation->indexes();
+            GeneratorCore::IterationState state = continuation->state();
+
+            for ( int i = 0; i < continuation->count(); i++ ) {
+                if ( m_known[ indexes[ i ] ] )
+                    m_continuation->append( indexes[ i ], state.m_zx[ i ], state.m_zy[ i ], state.m_iterations[ i ], state.m_reference[ i ] );
+            }
+
+            limitContinuation();
+        }
+    }
+
+    // the previous image is displayed until the regions are calculated again
+    m_coarseRegions = m_validRegions;
+    m_validRegions.clear();
+}
+
+void FractalGenerator::resumeRegion( const QRect& region, const GeneratorCore::Input& input, const GeneratorCore::Output& output,
+    GeneratorCore::Continuation* continuation, int maxIterations )
+{
+    // the resumed points are calculated before the others, which may depend on them
+    bool* known = m_known + region.top() * m_bufferSize.width() + region.left();
+    const int* indexes = continuation->indexes();
+    for ( int i = 0; i < continuation->count(); i++ )
+        known[ indexes[ i ] ] = true;
+
+#if defined( HAVE_AVX2 )
+    if ( m_functorAVX2 )
+        GeneratorCore::resumePointsAVX2( input, output, m_functorAVX2, maxIterations, continuation );
+    else
+#endif
+#if defined( HAVE_SSE2 )
+    if ( m_functorSSE2 )
+        GeneratorCore::resumePointsSSE2( input, output, m_functorSSE2, maxIterations, continuation );
+    else
+#endif
+    if ( m_functor )
+        GeneratorCore::resumePoints( input, output, m_functor, maxIterations, continuation );
+}
+
+void FractalGenerator::storeContinuation( const GeneratorCore::Continuation* continuation, const QRect& region, int stride )
+{
+    // the state was dropped by another region
+    if ( !m_continuation )
+        return;
+
+    const int* indexes = continuation->indexes();
+    GeneratorCore::IterationState state = continuation->state();
+
+    // convert the indexes to the buffer, skipping the points of tiles outside of it
+    for ( int i = 0; i < continuation->count(); i++ ) {
+        int x = region.left() + indexes[ i ] % stride;
+        int y = region.top() + indexes[ i ] / stride;
+        if ( x >= 0 && y >= 0 && x < m_bufferSize.width() && y < m_bufferSize.height() )
+            m_continuation->append( y * m_bufferSize.width() + x, state.m_zx[ i ], state.m_zy[ i ], state.m_iterations[ i ], state.m_reference[ i ] );
+    }
+
+    limitContinuation();
+}
+
+void FractalGenerator::limitContinuation()
+{
+    // when the state takes too much memory, the view is not resumed
+    if ( m_continuation->count() > m_continuationLimit ) {
+        delete m_continuation;
+        m_continuation = NULL;
+    }
+}
+
+static const int RegionsPerThread = 4;
+static const int MinimumPieceCells = 8;
+
 void FractalGenerator::splitRegions()
+{
+    if ( m_layer >= 0 )
+        splitTiles();
+    else
+        splitBlocks();
+
+    m_regionCosts.clear();
+    m_sharedColumns.clear();
+
+    // the cost of the details can be estimated from the preview grid
+    if ( m_pass == RefinementPass )
+        balanceRegions();
+
+    sortRegions();
+}
+
+void FractalGenerator::splitBlocks()
 {
     m_regions.clear();
 
-    int fullRegions = m_bufferSize.height() / RegionSize;
-    int remainder = m_bufferSize.height() - fullRegions * RegionSize;
+    QRegion valid;
+    for ( int i = 0; i < m_validRegions.count(); i++ )
+        valid += m_validRegions[ i ];
+
+    m_validRegions.clear();
 
-    for ( int i = 0; i < fullRegions; i++ ) {
-        QRect region( 0, i * RegionSize, m_bufferSize.width(), RegionSize );
-        m_regions.append( region );
+    // the size of the buffer is rounded, so the last block in each row and
+    // column is the only one which may be smaller
+    for ( int y = 0; y < m_bufferSize.height(); y += RegionSize ) {
+        for ( int x = 0; x < m_bufferSize.width(); x += RegionSize ) {
+            QRect block( x, y, qMin( RegionSize, m_bufferSize.width() - x ), qMin( RegionSize, m_bufferSize.height() - y ) );
+            splitBlock( block, valid );
+        }
     }
+}
 
-    if ( remainder > 0 ) {
-        QRect region( 0, fullRegions * RegionSize, m_bufferSize.width(), remainder );
-        m_regions.append( region );
+void FractalGenerator::splitBlock( const QRect& block, const QRegion& valid )
+{
+    QRect visible = block.intersected( QRect( QPoint( 0, 0 ), m_resolution ) );
+
+    // only a single range of valid columns can be preserved
+    QVector<QRect> rects = ( valid & visible ).rects();
+    if ( rects.count() != 1 || rects[ 0 ].top() != visible.top() || rects[ 0 ].bottom() != visible.bottom() ) {
+        m_regions.append( block );
+        return;
+    }
+
+    int left = rects[ 0 ].left();
+    int right = rects[ 0 ].right();
+
+    // the regions must be N * CellSize + 1 pixels wide, so they may
+    // overlap some of the valid columns
+    int leftWidth = ( left > visible.left() ) ? roundToCellSize( left - block.left() ) : 0;
+    int rightWidth = ( right < visible.right() ) ? roundToCellSize( block.right() - right ) : 0;
+    int leftEnd = block.left() + leftWidth;
+    int rightStart = block.right() + 1 - rightWidth;
+
+    if ( leftEnd >= rightStart ) {
+        m_regions.append( block );
+        return;
+    }
+
+    if ( leftWidth > 0 )
+        m_regions.append( QRect( block.left(), block.top(), leftWidth, block.height() ) );
+    if ( rightWidth > 0 )
+        m_regions.append( QRect( rightStart, block.top(), rightWidth, block.height() ) );
+
+    appendRegion( &m_validRegions, QRect( QPoint( qMax( left, leftEnd ), visible.top() ), QPoint( qMin( right, rightStart - 1 ), visible.bottom() ) ) );
+}
+
+void FractalGenerator::balanceRegions()
+{
+    int maxIterations = maximumIterations();
+    double threshold = m_settings.detailThreshold();
+
+    QList<QVector<double> > costs;
+    double total = 0.0;
+
+    for ( int i = 0; i < m_regions.count(); i++ ) {
+        GeneratorCore::Output output;
+        calculateOutput( &output, m_regions[ i ] );
+
+        QVector<double> cost( ( output.m_width - 1 ) / GeneratorCore::CellSize );
+        GeneratorCore::estimateDetails( output, threshold, maxIterations, cost.data() );
+
+        for ( int j = 0; j < cost.count(); j++ )
+            total += cost[ j ];
+        costs.append( cost );
+    }
+
+    // each thread should get a few regions of about the same cost
+    int threads = fraqtive()->jobScheduler()->maximumThreads();
+    m_batchCost = total / (double)( RegionsPerThread * threads );
+
+    // only the blocks refined using the grid can be split into pieces, because
+    // the pieces share the columns of the grid at their boundaries
+    bool split = ( m_layer < 0 && m_settings.samplingMethod() == GridSampling );
+
+    QList<QRect> regions = m_regions;
+    m_regions.clear();
+
+    for ( int i = 0; i < regions.count(); i++ ) {
+        const QRect& region = regions[ i ];
+        const QVector<double>& cost = costs[ i ];
+
+        double sum = 0.0;
+        for ( int j = 0; j < cost.count(); j++ )
+            sum += cost[ j ];
+
+        if ( !split || sum <= 2.0 * m_batchCost || cost.count() < 2 * MinimumPieceCells ) {
+            m_regions.append( region );
+            m_regionCosts.append( sum );
+            continue;
+        }
+
+        int first = 0;
+        double pieceCost = 0.0;
+
+        for ( int j = 0; j < cost.count(); j++ ) {
+            pieceCost += cost[ j ];
+
+            bool last = ( j == cost.count() - 1 );
+            bool full = ( pieceCost >= m_batchCost && j + 1 - first >= MinimumPieceCells && cost.count() - j - 1 >= MinimumPieceCells );
+
+            if ( last || full ) {
+                QRect piece( region.left() + first * GeneratorCore::CellSize, region.top(), ( j + 1 - first ) * GeneratorCore::CellSize + 1, region.height() );
+                if ( first > 0 )
+                    m_sharedColumns.insert( qMakePair( piece.left(), piece.top() ) );
+
+                m_regions.append( piece );
+                m_regionCosts.append( pieceCost );
+
+                first = j + 1;
+                pieceCost = 0.0;
+            }
+        }
+    }
+}
+
+void FractalGenerator::sortRegions()
+{
+    QPointF focus = m_focused ? m_focusPoint : QPointF( m_resolution.width() / 2.0, m_resolution.height() / 2.0 );
+
+    // order the regions by the distance of their centers from the focus point
+    QList<QPair<double, int> > order;
+    for ( int i = 0; i < m_regions.count(); i++ ) {
+        QPointF delta = QRectF( m_regions[ i ] ).center() - focus;
+        order.append( qMakePair( delta.x() * delta.x() + delta.y() * delta.y(), i ) );
+    }
+
+    qSort( order );
+
+    QList<QRect> regions = m_regions;
+    QList<double> costs = m_regionCosts;
+
+    m_regions.clear();
+    m_regionCosts.clear();
+
+    for ( int i = 0; i < order.count(); i++ ) {
+        m_regions.append( regions[ order[ i ].second ] );
+        if ( !costs.isEmpty() )
+            m_regionCosts.append( costs[ order[ i ].second ] );
+    }
+}
+
+QRect FractalGenerator::takeRegion( double* cost )
+{
+    if ( !m_regionCosts.isEmpty() )
+        *cost += m_regionCosts.takeFirst();
+
+    return m_regions.takeFirst();
+}
+
+bool* FractalGenerator::markSharedColumn( const GeneratorCore::Output& output )
+{
+    int size = output.m_stride * ( output.m_height - 1 ) + output.m_width;
+
+    bool* known = new bool[ size ];
+    for ( int i = 0; i < size; i++ )
+        known[ i ] = output.m_known && output.m_known[ i ];
+
+    for ( int y = 0; y < output.m_height; y++ )
+        known[ y * output.m_stride ] = true;
+
+    return known;
+}
+
+void FractalGenerator::setupTiles( int base, bool refine )
+{
+    double scale = pow( 10.0, -m_position.zoomFactor() ) / (double)m_resolution.height();
+
+    m_layer = m_tileCache->findLayer( m_type, m_settings, m_position, m_resolution.height(), base );
+    Position anchor = m_tileCache->layerAnchor( m_layer );
+
+    // the coordinates of the first pixel relative to the anchor of the layer
+    double x = ( m_position.centerX() - anchor.centerX() ).toDouble() / scale - (double)m_resolution.width() / 2.0 - 0.5;
+    double y = ( m_position.centerY() - anchor.centerY() ).toDouble() / scale - (double)m_resolution.height() / 2.0 - 0.5;
+
+    if ( qAbs( x ) > 1e9 || qAbs( y ) > 1e9 ) {
+        m_tileCache->removeLayer( m_layer );
+        m_layer = m_tileCache->findLayer( m_type, m_settings, m_position, m_resolution.height() );
+        x = -(double)m_resolution.width() / 2.0 - 0.5;
+        y = -(double)m_resolution.height() / 2.0 - 0.5;
+    }
+
+    // the tiles of the base layer can only be refined when they are aligned
+    m_baseLayer = ( refine && base >= 0 && m_tileCache->layerAnchor( base ) == m_tileCache->layerAnchor( m_layer ) ) ? base : -1;
+
+    m_tileOrigin = QPoint( qRound( x ), qRound( y ) );
+
+    // the view is moved by less than half a pixel to align it with the tiles
+    m_phase = QPointF( m_tileOrigin.x() - x, m_tileOrigin.y() - y );
+}
+
+void FractalGenerator::splitTiles()
+{
+    m_regions.clear();
+    m_validRegions.clear();
+
+    const int size = TileCache::TileSize;
+
+    int left = divideFloor( m_tileOrigin.x(), size );
+    int right = divideFloor( m_tileOrigin.x() + m_resolution.width() - 1, size );
+    int top = divideFloor( m_tileOrigin.y(), size );
+    int bottom = divideFloor( m_tileOrigin.y() + m_resolution.height() - 1, size );
+
+    for ( int y = top; y <= bottom; y++ ) {
+        for ( int x = left; x <= right; x++ ) {
+            QRect region( x * size - m_tileOrigin.x(), y * size - m_tileOrigin.y(), size, size );
+
+            const TileCache::Tile* tile = m_tileCache->tile( m_layer, x, y );
+            if ( tile ) {
+                copyTile( tile, region );
+                appendRegion( &m_validRegions, region );
+            } else {
+                m_regions.append( region );
+            }
+        }
+    }
+}
+
+QPair<int, int> FractalGenerator::tileKey( const QRect& region ) const
+{
+    return qMakePair( ( region.left() + m_tileOrigin.x() ) / TileCache::TileSize, ( region.top() + m_tileOrigin.y() ) / TileCache::TileSize );
+}
+
+void FractalGenerator::copyTile( const TileCache::Tile* tile, const QRect& region )
+{
+    QRect visible = region.intersected( QRect( QPoint( 0, 0 ), m_resolution ) );
+    int stride = m_bufferSize.width();
+
+    for ( int y = visible.top(); y <= visible.bottom(); y++ ) {
+        const double* src = tile->m_buffer + ( y - region.top() ) * TileCache::TileSize + visible.left() - region.left();
+        memcpy( m_buffer + y * stride + visible.left(), src, visible.width() * sizeof( double ) );
+    }
+}
+
+bool* FractalGenerator::copyBaseTile( const QRect& region, const GeneratorCore::Output& output )
+{
+    QPair<int, int> key = tileKey( region );
+    const TileCache::Tile* tile = m_tileCache->tile( m_baseLayer, key.first, key.second );
+    if ( !tile )
+        return NULL;
+
+    memcpy( output.m_buffer, tile->m_buffer, sizeof( TileCache::Tile ) );
+
+    const int size = TileCache::TileSize * TileCache::TileSize;
+
+    bool* known = new bool[ size ];
+    for ( int i = 0; i < size; i++ )
+        known[ i ] = false;
+
+    GeneratorCore::markDetails( output, m_baseThreshold, known );
+
+    return known;
+}
+
+bool* FractalGenerator::copyKnownTile( const QRect& region, const GeneratorCore::Output& output )
+{
+    const int size = TileCache::TileSize * TileCache::TileSize;
+
+    bool* known = new bool[ size ];
+    for ( int i = 0; i < size; i++ )
+        known[ i ] = false;
+
+    // the points reused from the previous layer are copied from the buffer
+    QRect visible = region.intersected( QRect( QPoint( 0, 0 ), m_resolution ) );
+    int stride = m_bufferSize.width();
+
+    for ( int y = visible.top(); y <= visible.bottom(); y++ ) {
+        for ( int x = visible.left(); x <= visible.right(); x++ ) {
+            if ( m_known[ y * stride + x ] ) {
+                int index = ( y - region.top() ) * TileCache::TileSize + x - region.left();
+                output.m_buffer[ index ] = m_buffer[ y * stride + x ];
+                known[ index ] = true;
+            }
+        }
+    }
+
+    return known;
+}
+
+void FractalGenerator::storeTile( const QRect& region, bool complete )
+{
+    QPair<int, int> key = tileKey( region );
+    TileCache::Tile* tile = m_tiles.value( key );
+
+    copyTile( tile, region );
+
+    if ( complete ) {
+        m_tiles.remove( key );
+        m_tileCache->insertTile( m_layer, key.first, key.second, tile );
     }
 }
 
@@ -360,26 +1359,51 @@ void FractalGenerator::calculateInput( GeneratorCore::Input* input, const QRect&
     double sa = scale * sin( m_position.angle() * M_PI / 180.0 );
     double ca = scale * cos( m_position.angle() * M_PI / 180.0 );
 
-    double offsetX = (double)region.left() - (double)m_resolution.width() / 2.0 - 0.5;
-    double offsetY = (double)region.top() - (double)m_resolution.height() / 2.0 - 0.5;
+    double offsetX = (double)region.left() - (double)m_resolution.width() / 2.0 - 0.5 + m_phase.x();
+    double offsetY = (double)region.top() - (double)m_resolution.height() / 2.0 - 0.5 + m_phase.y();
+
+    // the extended precision functors use coordinates relative to the center
+    QPointF center = ( m_precision >= DoubleDoublePrecision ) ? QPointF() : m_position.center();
 
     input->m_sa = sa;
     input->m_ca = ca;
-    input->m_x = m_position.center().x() + ca * offsetX + sa * offsetY;
-    input->m_y = m_position.center().y() - sa * offsetX + ca * offsetY;
+    input->m_x = center.x() + ca * offsetX + sa * offsetY;
+    input->m_y = center.y() - sa * offsetX + ca * offsetY;
 }
 
 void FractalGenerator::calculateOutput( GeneratorCore::Output* output, const QRect& region )
 {
+    // tiles may exceed the buffer, so they are calculated separately
+    if ( m_layer >= 0 ) {
+        TileCache::Tile* tile = m_tiles.value( tileKey( region ) );
+        if ( !tile ) {
+            tile = new TileCache::Tile;
+            m_tiles.insert( tileKey( region ), tile );
+        }
+        output->m_buffer = tile->m_buffer;
+        output->m_stride = TileCache::TileSize;
+        output->m_width = region.width();
+        output->m_height = region.height();
+        output->m_known = NULL;
+        output->m_continuation = NULL;
+        return;
+    }
+
     output->m_buffer = m_buffer + region.top() * m_bufferSize.width() + region.left();
     output->m_stride = m_bufferSize.width();
     output->m_width = region.width();
     output->m_height = region.height();
+    output->m_known = m_known ? m_known + region.top() * m_bufferSize.width() + region.left() : NULL;
+    output->m_continuation = NULL;
 }
 
 void FractalGenerator::addJobs()
 {
-    int count = m_regions.count();
+    // no jobs are running, so the calculation is no longer cancelled
+    m_cancellation.reset();
+
+    // the orbit must be calculated before the regions
+    int count = m_orbitPending ? 1 : m_regions.count();
     if ( count > 0 ) {
         fraqtive()->jobScheduler()->addJobs( this, count );
         m_activeJobs += count;
@@ -388,6 +1412,9 @@ void FractalGenerator::addJobs()
 
 void FractalGenerator::cancelJobs()
 {
+    // the jobs which are running are aborted
+    m_cancellation.cancel();
+
     int count = fraqtive()->jobScheduler()->cancelAllJobs( this );
     m_activeJobs -= count;
 
@@ -403,30 +1430,32 @@ void FractalGenerator::finishJob()
         m_allJobsDone.wakeAll();
 }
 
-void FractalGenerator::appendValidRegion( const QRect& region )
+void FractalGenerator::appendRegion( QList<QRect>* regions, const QRect& region )
 {
     QRect clipped = region.intersected( QRect( QPoint( 0, 0 ), m_resolution ) );
     if ( clipped.isEmpty() )
         return;
 
-    for ( int i = 0; i < m_validRegions.count(); i++ ) {
-        if ( m_validRegions[ i ].bottom() + 1 == clipped.top() ) {
-            if ( i + 1 < m_validRegions.count() && m_validRegions[ i + 1 ].top() == clipped.bottom() + 1 )
-                m_validRegions[ i ].setBottom( m_validRegions.takeAt( i + 1 ).bottom() );
-            else
-                m_validRegions[ i ].setBottom( clipped.bottom() );
-            return;
-        }
-        if ( m_validRegions[ i ].top() == clipped.bottom() + 1 ) {
-            m_validRegions[ i ].setTop( clipped.top() );
-            return;
-        }
-        if ( m_validRegions[ i ].top() > clipped.top() ) {
-            m_validRegions.insert( i, clipped );
-            return;
+    // merge with adjacent regions of the same width or height
+    for ( int i = 0; i < regions->count(); ) {
+        const QRect& other = regions->at( i );
+        bool vertical = other.left() == clipped.left() && other.right() == clipped.right()
+            && ( other.bottom() + 1 == clipped.top() || other.top() == clipped.bottom() + 1 );
+        bool horizontal = other.top() == clipped.top() && other.bottom() == clipped.bottom()
+            && ( other.right() + 1 == clipped.left() || other.left() == clipped.right() + 1 );
+        if ( vertical || horizontal ) {
+            clipped = clipped.united( regions->takeAt( i ) );
+            i = 0;
+        } else {
+            i++;
         }
     }
-    m_validRegions.append( clipped );
+
+    // keep the regions sorted from top to bottom
+    int index = 0;
+    while ( index < regions->count() && regions->at( index ).top() <= clipped.top() )
+        index++;
+    regions->insert( index, clipped );
 }
 
 void FractalGenerator::postUpdate( UpdateStatus update )
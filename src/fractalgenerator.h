@@ -20,12 +20,17 @@
 #define FRACTALGENERATOR_H
 
 #include <QEvent>
+#include <QHash>
 #include <QMutex>
+#include <QSet>
 #include <QWaitCondition>
 
 #include "abstractjobprovider.h"
 #include "datastructures.h"
 #include "generatorcore.h"
+#include "tilecache.h"
+
+class QRegion;
 
 class FractalData;
 
@@ -50,6 +55,17 @@ public:
 
 public:
     void setPreviewMode( bool preview );
+    void setProgressiveMode( bool progressive );
+
+    // unrotated views are assembled from tiles which are cached in memory;
+    // the size is given in megabytes, 0 disables the cache
+    void setTileCacheSize( int size );
+
+    // the state of points which didn't escape is kept, so that they are
+    // iterated further when only the calculation depth is increased; the size
+    // is given in megabytes, 0 disables resuming
+    void setResumableMemory( int size );
+
     void setPriority( int priority );
     void setReceiver( QObject* receiver );
 
@@ -64,6 +80,11 @@ public:
     void setResolution( const QSize& resolution );
     QSize resolution() const { return m_resolution; }
 
+    // the regions closest to the focus point are calculated first; by default
+    // it's the center of the view
+    void setFocusPoint( const QPointF& point );
+    void clearFocusPoint();
+
     int maximumIterations() const;
 
     UpdateStatus updateData( FractalData* data );
@@ -74,6 +95,8 @@ public: // AbstractJobProvider implementation
     void executeJob();
 
 private:
+    void calculateOrbit();
+    void calculateCoarseRegion( const QRect& region );
     void calculateRegion( const QRect& region );
 
     void reset();
@@ -82,7 +105,35 @@ private:
 
     void createFunctor();
 
+    bool calculateZoomStep( int* step );
+    bool calculateMapping( int* step, QPoint* offset );
+    void shiftBuffer( const QPoint& shift );
+    void zoomBuffer( int step, const QPoint& offset );
+    void resumeBuffer( const GeneratorCore::Continuation* continuation, int maxIterations );
+    void refineBuffer( const GeneratorCore::Continuation* continuation, double threshold );
+
+    void resumeRegion( const QRect& region, const GeneratorCore::Input& input, const GeneratorCore::Output& output,
+        GeneratorCore::Continuation* continuation, int maxIterations );
+    void storeContinuation( const GeneratorCore::Continuation* continuation, const QRect& region, int stride );
+    void limitContinuation();
+
     void splitRegions();
+    void splitBlocks();
+    void splitBlock( const QRect& block, const QRegion& valid );
+
+    void balanceRegions();
+    void sortRegions();
+    QRect takeRegion( double* cost );
+    bool* markSharedColumn( const GeneratorCore::Output& output );
+
+    void setupTiles( int base, bool refine );
+    void splitTiles();
+
+    QPair<int, int> tileKey( const QRect& region ) const;
+    void copyTile( const TileCache::Tile* tile, const QRect& region );
+    bool* copyBaseTile( const QRect& region, const GeneratorCore::Output& output );
+    bool* copyKnownTile( const QRect& region, const GeneratorCore::Output& output );
+    void storeTile( const QRect& region, bool complete );
 
     void calculateInput( GeneratorCore::Input* input, const QRect& region );
     void calculateOutput( GeneratorCore::Output* output, const QRect& region );
@@ -91,12 +142,22 @@ private:
     void cancelJobs();
     void finishJob();
 
-    void appendValidRegion( const QRect& region );
+    void appendRegion( QList<QRect>* regions, const QRect& region );
 
     void postUpdate( UpdateStatus update );
 
+private:
+    enum Pass
+    {
+        FullPass,
+        CoarsePass,
+        RefinementPass
+    };
+
 private:
     bool m_preview;
+    bool m_progressive;
+    int m_continuationLimit;
     int m_priority;
     QObject* m_receiver;
 
@@ -104,6 +165,10 @@ private:
 
     bool m_enabled;
 
+    bool m_focused;
+    QPointF m_focusPoint;
+    QPoint m_focusBlock;
+
     FractalType m_type;
     Position m_position;
     GeneratorSettings m_settings;
@@ -115,14 +180,50 @@ private:
 #if defined( HAVE_SSE2 )
     GeneratorCore::FunctorSSE2* m_functorSSE2;
 #endif
+#if defined( HAVE_AVX2 )
+    GeneratorCore::FunctorAVX2* m_functorAVX2;
+#endif
+
+    Precision m_precision;
+
+    GeneratorCore::ReferenceOrbit* m_orbit;
+    bool m_orbitPending;
 
     double* m_buffer;
+    bool* m_known;
 
     QList<QRect> m_regions;
+    Pass m_pass;
+
+    // the estimated costs of the regions in the refinement pass
+    QList<double> m_regionCosts;
+    double m_batchCost;
+
+    // the regions whose first column is calculated by the region on the left
+    QSet<QPair<int, int> > m_sharedColumns;
+
+    int m_tileCacheSize;
+    TileCache* m_tileCache;
+
+    int m_layer;
+    QPoint m_tileOrigin;
+    QPointF m_phase;
+
+    int m_baseLayer;
+    double m_baseThreshold;
+
+    QHash<QPair<int, int>, TileCache::Tile*> m_tiles;
+
+    GeneratorCore::Continuation* m_continuation;
+    QHash<QPair<int, int>, GeneratorCore::Continuation*> m_resumed;
+
+    QList<QRect> m_gridRegions;
 
     int m_activeJobs;
     QWaitCondition m_allJobsDone;
 
+    GeneratorCore::Cancellation m_cancellation;
+
     bool m_pending;
 
     FractalType m_pendingType;
@@ -134,6 +235,7 @@ private:
 
     UpdateStatus m_update;
     QList<QRect> m_validRegions;
+    QList<QRect> m_coarseRegions;
 
     double* m_previewBuffer;
 };
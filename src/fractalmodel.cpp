@@ -41,6 +41,10 @@ static void initializeDefaultSettings()
             config->setValue( "GeneratorSettings", QVariant::fromValue( DataFunctions::defaultGeneratorSettings() ) );
         if ( !config->contains( "ViewSettings" ) )
             config->setValue( "ViewSettings", QVariant::fromValue( DataFunctions::defaultViewSettings() ) );
+        if ( !config->contains( "TileCacheSize" ) )
+            config->setValue( "TileCacheSize", 64 );
+        if ( !config->contains( "ResumableMemory" ) )
+            config->setValue( "ResumableMemory", 32 );
 
         initialized = true;
     }
@@ -58,6 +62,9 @@ FractalModel::FractalModel( QObject* parent ) : QObject( parent ),
 
     m_presenter = new FractalPresenter( this );
     m_presenter->setModel( this );
+    m_presenter->setProgressiveMode( true );
+    m_presenter->setTileCacheSize( fraqtive()->configuration()->value( "TileCacheSize" ).toInt() );
+    m_presenter->setResumableMemory( fraqtive()->configuration()->value( "ResumableMemory" ).toInt() );
 
     m_timer = new QTimer( this );
     m_timer->setInterval( 50 );
@@ -82,11 +89,20 @@ void FractalModel::setEnabled( bool enabled )
     }
 }
 
+static Position limitZoomFactor( const FractalType& type, const Position& position )
+{
+    Position result = position;
+    result.setZoomFactor( qMin( position.zoomFactor(), DataFunctions::maximumZoomFactor( type ) ) );
+    return result;
+}
+
 void FractalModel::setParameters( const FractalType& type, const Position& position )
 {
-    if ( m_fractalType != type || m_position != position ) {
+    Position limited = limitZoomFactor( type, position );
+
+    if ( m_fractalType != type || m_position != limited ) {
         storeParameters();
-        setParametersInternal( type, position );
+        setParametersInternal( type, limited );
     }
 }
 
@@ -114,6 +130,13 @@ void FractalModel::setParametersInternal( const FractalType& type, const Positio
 void FractalModel::setFractalType( const FractalType& type )
 {
     if ( m_fractalType != type ) {
+        // the current position may be too deep for the new type
+        Position limited = limitZoomFactor( type, m_position );
+        if ( limited != m_position ) {
+            setParameters( type, limited );
+            return;
+        }
+
         storeParameters();
         m_fractalType = type;
         m_presenter->setFractalType( type );
@@ -123,10 +146,12 @@ void FractalModel::setFractalType( const FractalType& type )
 
 void FractalModel::setPosition( const Position& position )
 {
-    if ( m_position != position ) {
+    Position limited = limitZoomFactor( m_fractalType, position );
+
+    if ( m_position != limited ) {
         storeParameters();
-        m_position = position;
-        m_presenter->setPosition( position );
+        m_position = limited;
+        m_presenter->setPosition( limited );
         emit positionChanged();
     }
 }
@@ -143,9 +168,11 @@ bool FractalModel::hasDefaultPosition() const
 
 void FractalModel::setTrackingPosition( const Position& position )
 {
-    if ( !m_tracking || m_trackingPosition != position ) {
+    Position limited = limitZoomFactor( m_fractalType, position );
+
+    if ( !m_tracking || m_trackingPosition != limited ) {
         m_tracking = true;
-        m_trackingPosition = position;
+        m_trackingPosition = limited;
         emit trackingChanged();
     }
 }
@@ -69,6 +69,21 @@ void FractalPresenter::setPreviewMode( bool preview )
     }
 }
 
+void FractalPresenter::setProgressiveMode( bool progressive )
+{
+    m_generator->setProgressiveMode( progressive );
+}
+
+void FractalPresenter::setTileCacheSize( int size )
+{
+    m_generator->setTileCacheSize( size );
+}
+
+void FractalPresenter::setResumableMemory( int size )
+{
+    m_generator->setResumableMemory( size );
+}
+
 void FractalPresenter::setPriority( int priority )
 {
     m_generator->setPriority( priority );
@@ -221,6 +236,9 @@ void FractalPresenter::setResolution( const QSize& resolution )
 
 void FractalPresenter::setHoveringPoint( const QPointF& point )
 {
+    // the regions around the cursor are calculated first
+    m_generator->setFocusPoint( point );
+
     if ( m_model && m_model->fractalType().fractal() != JuliaFractal ) {
         m_hoveringPoint = point;
         m_model->setHoveringParameters( juliaType( point ), juliaPosition() );
@@ -229,6 +247,8 @@ void FractalPresenter::setHoveringPoint( const QPointF& point )
 
 void FractalPresenter::clearHovering()
 {
+    m_generator->clearFocusPoint();
+
     if ( m_model )
         m_model->clearHovering();
 }
@@ -308,14 +328,19 @@ void FractalPresenter::customEvent( QEvent* e )
     }
 }
 
+// the transforms are relative to the center of the current position, because
+// the absolute coordinates cannot be represented as doubles at large zoom factors
 QTransform FractalPresenter::transformFromPosition( const Position& position )
 {
     QPointF center( m_resolution.width() / 2.0, m_resolution.height() / 2.0 );
 
     double scale = pow( 10.0, -position.zoomFactor() ) / m_resolution.height();
 
+    double offsetX = ( position.centerX() - m_position.centerX() ).toDouble();
+    double offsetY = ( position.centerY() - m_position.centerY() ).toDouble();
+
     QTransform transform;
-    transform.translate( position.center().x(), position.center().y() );
+    transform.translate( offsetX, offsetY );
     transform.rotate( -position.angle() );
     transform.scale( scale, scale );
     transform.translate( -center.x(), -center.y() );
@@ -331,7 +356,8 @@ Position FractalPresenter::positionFromTransform( const QTransform& transform )
     QLineF mapped = preciselyMap( transform, line );
 
     Position position;
-    position.setCenter( mapped.p1() );
+    position.setCenter( m_position.centerX(), m_position.centerY() );
+    position.moveCenter( mapped.p1() );
     position.setZoomFactor( -log10( mapped.length() ) );
     position.setAngle( -atan2( mapped.dy(), mapped.dx() ) * 180.0 / M_PI );
 
@@ -348,7 +374,7 @@ FractalType FractalPresenter::juliaType( const QPointF& point )
 
     FractalType type = m_type;
     type.setFractal( JuliaFractal );
-    type.setParameter( mapped );
+    type.setParameter( m_position.center() + mapped );
 
     return type;
 }
@@ -41,6 +41,9 @@ public:
     void setView( AbstractView* view );
 
     void setPreviewMode( bool preview );
+    void setProgressiveMode( bool progressive );
+    void setTileCacheSize( int size );
+    void setResumableMemory( int size );
     void setPriority( int priority );
 
     void setEnabled( bool enabled );
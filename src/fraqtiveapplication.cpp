@@ -23,6 +23,9 @@
 #include <QPushButton>
 #include <QDesktopServices>
 #include <QUrl>
+#include <QStringList>
+#include <QSet>
+#include <QtAlgorithms>
 
 #if defined( Q_OS_WIN )
 #include <shlobj.h>
@@ -54,11 +57,12 @@ FraqtiveApplication::FraqtiveApplication( int& argc, char** argv ) : QApplicatio
 
     registerDataStructures();
 
-    m_jobScheduler = new JobScheduler();
-
     m_configuration = new ConfigurationData();
     m_configuration->readConfiguration();
 
+    m_jobScheduler = new JobScheduler();
+    configureJobScheduler();
+
     m_mainWindow = new FraqtiveMainWindow();
     m_mainWindow->show();
 
@@ -82,6 +86,63 @@ FraqtiveApplication::~FraqtiveApplication()
     m_configuration = NULL;
 }
 
+// returns the value of an option given as --name=value or --name on the command
+// line, or the value stored in the configuration
+static QVariant option( const QStringList& arguments, const QString& name, const QVariant& value )
+{
+    QString prefix = "--" + name;
+    for ( int i = 1; i < arguments.count(); i++ ) {
+        if ( arguments[ i ] == prefix )
+            return true;
+        if ( arguments[ i ].startsWith( prefix + "=" ) )
+            return arguments[ i ].mid( prefix.length() + 1 );
+    }
+    return value;
+}
+
+// parses a list of processors such as "0-3,8"; invalid ranges are ignored
+static QList<int> parseProcessors( const QString& text )
+{
+    int limit = JobScheduler::processorLimit();
+
+    QSet<int> processors;
+
+    QStringList parts = text.split( ',', QString::SkipEmptyParts );
+    for ( int i = 0; i < parts.count(); i++ ) {
+        QStringList range = parts[ i ].split( '-' );
+        if ( range.count() > 2 )
+            continue;
+
+        bool ok = true;
+        int first = range.first().trimmed().toInt( &ok );
+        int last = first;
+        if ( ok && range.count() == 2 )
+            last = range.last().trimmed().toInt( &ok );
+        if ( !ok || first < 0 || last < first || last >= limit )
+            continue;
+
+        for ( int j = first; j <= last; j++ )
+            processors.insert( j );
+    }
+
+    QList<int> result = processors.toList();
+    qSort( result );
+
+    return result;
+}
+
+void FraqtiveApplication::configureJobScheduler()
+{
+    QStringList args = arguments();
+
+    m_jobScheduler->setMaximumThreads( option( args, "threads", m_configuration->value( "Threads", 0 ) ).toInt() );
+    m_jobScheduler->setProcessors( parseProcessors( option( args, "processors", m_configuration->value( "Processors" ) ).toString() ) );
+    m_jobScheduler->setIdleScheduling( option( args, "idle-scheduling", m_configuration->value( "IdleScheduling", false ) ).toBool() );
+    // the timeout is given in seconds; a day is long enough not to overflow
+    int timeout = qBound( 0, option( args, "idle-timeout", m_configuration->value( "IdleTimeout", 60 ) ).toInt(), 86400 );
+    m_jobScheduler->setIdleTimeout( 1000 * timeout );
+}
+
 QString FraqtiveApplication::version() const
 {
     return "0.4.8";
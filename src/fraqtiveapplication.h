@@ -48,6 +48,8 @@ public slots:
 private:
     QString version() const;
 
+    void configureJobScheduler();
+
     QString technicalInformation();
 
 private:
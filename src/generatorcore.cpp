@@ -16,41 +16,30 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **************************************************************************/
 
-#include "generatorcore.h"
-
-#include <qglobal.h>
-
-#include <math.h>
-#include <cstdlib>
+#include "generatorcore_p.h"
 
 #if defined( HAVE_SSE2 )
 # include <emmintrin.h>
 #endif
 
+#if defined( HAVE_AVX2 )
+# if defined( Q_CC_MSVC )
+#  include <intrin.h>
+# else
+#  include <cpuid.h>
+# endif
+#endif
+
 // see http://wiki.mimec.org/wiki/Fraqtive/Generator_Core for a description of this code
 
 namespace GeneratorCore
 {
 
-static const double BailoutRadius = 64.0;
-
 #if defined( Q_CC_MSVC )
 # pragma float_control( precise, off )
 # pragma intrinsic( log, sqrt, exp, atan2, sin, cos, fabs )
 #endif
 
-static const double BailoutLog = log( 2.0 * log( BailoutRadius ) );
-
-static inline double calculateResult( int maxIterations, int count, double final, double exponent )
-{
-    if ( count == 0 )
-        return 0.0;
-
-    double value = ( maxIterations - count ) + ( BailoutLog - log( log( sqrt( final ) ) ) ) / log( exponent );
-
-    return sqrt( value );
-}
-
 template<Variant VARIANT>
 static void adjust( double& /*zx*/, double& /*zy*/ );
 
@@ -78,16 +67,16 @@ inline void adjust<AbsoluteImVariant>( double& /*zx*/, double& zy )
     zy = fabs( zy );
 }
 
+// the scalar kernels update z and the remaining number of iterations k,
+// so that they can be resumed
 template<Variant VARIANT>
-static inline double calculate( double x, double y, double cx, double cy, double exponent, int maxIterations )
+static inline double calculate( double& zx, double& zy, double cx, double cy, double exponent, int maxIterations, int& k )
 {
-    double zx = x;
-    double zy = y;
     double radius;
 
     double exp2 = 0.5 * exponent;
 
-    for ( int k = maxIterations; k > 0; k-- ) {
+    for ( ; k > 0; k-- ) {
         adjust<VARIANT>( zx, zy );
 
         double zxx = zx * zx;
@@ -112,17 +101,16 @@ static inline double calculate( double x, double y, double cx, double cy, double
 # pragma function( log, sqrt, exp, atan2, sin, cos, fabs )
 #endif
 
-class MandelbrotParams
+// returns the remaining number of iterations of a point of the state,
+// initializing it if the point is started from the beginning
+static inline int resumeState( const IterationState& state, int i, double x, double y, int maxIterations )
 {
-public:
-    MandelbrotParams( double exponent ) :
-        m_exponent( exponent )
-    {
+    if ( state.m_iterations[ i ] == 0 ) {
+        state.m_zx[ i ] = x;
+        state.m_zy[ i ] = y;
     }
-
-protected:
-    double m_exponent;
-};
+    return maxIterations - state.m_iterations[ i ];
+}
 
 template<Variant VARIANT>
 class MandelbrotFunctor : public Functor, public MandelbrotParams
@@ -132,24 +120,25 @@ public:
     {
     }
 
-    double operator()( double zx, double zy, int maxIterations )
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
     {
-        return calculate<VARIANT>( zx, zy, zx, zy, m_exponent, maxIterations );
+        for ( int i = 0; i < count && !isCancelled( m_cancellation ); i++ ) {
+            double x = zx[ i ];
+            double y = zy[ i ];
+            int k = maxIterations;
+            result[ i ] = calculate<VARIANT>( x, y, zx[ i ], zy[ i ], m_exponent, maxIterations, k );
+        }
     }
-};
 
-class JuliaParams : public MandelbrotParams
-{
-public:
-    JuliaParams( double cx, double cy, double exponent ) : MandelbrotParams( exponent ),
-        m_cx( cx ),
-        m_cy( cy )
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
     {
+        for ( int i = 0; i < count && !isCancelled( m_cancellation ); i++ ) {
+            int k = resumeState( state, i, x[ i ], y[ i ], maxIterations );
+            result[ i ] = calculate<VARIANT>( state.m_zx[ i ], state.m_zy[ i ], x[ i ], y[ i ], m_exponent, maxIterations, k );
+            state.m_iterations[ i ] = maxIterations - k;
+        }
+        return true;
     }
-
-protected:
-    double m_cx;
-    double m_cy;
 };
 
 template<Variant VARIANT>
@@ -160,54 +149,25 @@ public:
     {
     }
 
-    double operator()( double zx, double zy, int maxIterations )
-    {
-        return calculate<VARIANT>( zx, zy, m_cx, m_cy, m_exponent, maxIterations );
-    }
-};
-
-template<typename BASE, template<Variant VARIANT> class FACTORY>
-class VariantDispatcher
-{
-public:
-    template<typename PARAMS>
-    static BASE* create( Variant variant, const PARAMS& params )
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
     {
-        switch ( variant ) {
-            case NormalVariant:
-                return FACTORY<NormalVariant>::create( params );
-            case ConjugateVariant:
-                return FACTORY<ConjugateVariant>::create( params );
-            case AbsoluteVariant:
-                return FACTORY<AbsoluteVariant>::create( params );
-            case AbsoluteImVariant:
-                return FACTORY<AbsoluteImVariant>::create( params );
+        for ( int i = 0; i < count && !isCancelled( m_cancellation ); i++ ) {
+            double x = zx[ i ];
+            double y = zy[ i ];
+            int k = maxIterations;
+            result[ i ] = calculate<VARIANT>( x, y, m_cx, m_cy, m_exponent, maxIterations, k );
         }
-        return NULL;
-    }
-};
-
-template<typename BASE, template<Variant VARIANT> class FUNCTOR>
-class FunctorFactory
-{
-public:
-    template<typename PARAMS>
-    static BASE* create( Variant variant, const PARAMS& params )
-    {
-        return VariantDispatcher<BASE, InnerFactory>::create( variant, params );
     }
 
-private:
-    template<Variant VARIANT>
-    class InnerFactory
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
     {
-    public:
-        template<typename PARAMS>
-        static BASE* create( const PARAMS& params )
-        {
-            return new FUNCTOR<VARIANT>( params );
+        for ( int i = 0; i < count && !isCancelled( m_cancellation ); i++ ) {
+            int k = resumeState( state, i, x[ i ], y[ i ], maxIterations );
+            result[ i ] = calculate<VARIANT>( state.m_zx[ i ], state.m_zy[ i ], m_cx, m_cy, m_exponent, maxIterations, k );
+            state.m_iterations[ i ] = maxIterations - k;
         }
-    };
+        return true;
+    }
 };
 
 Functor* createMandelbrotFunctor( double exponent, Variant variant )
@@ -265,12 +225,14 @@ inline void calculatePower<1>( double& /*zx*/, double& /*zy*/, double& /*radius*
 }
 
 template<int N, Variant VARIANT>
-static double calculateFast( double x, double y, double cx, double cy, int maxIterations )
+static double calculateFast( double& zx, double& zy, double cx, double cy, double tolerance, int maxIterations, int& k )
 {
-    double zx = x;
-    double zy = y;
+    double px = zx;
+    double py = zy;
+    int interval = CycleInterval;
+    int checkpoint = k - interval;
 
-    for ( int k = maxIterations; k > 0; k-- ) {
+    for ( ; k > 0; k-- ) {
         adjust<VARIANT>( zx, zy );
 
         double radius;
@@ -281,19 +243,21 @@ static double calculateFast( double x, double y, double cx, double cy, int maxIt
 
         zx += cx;
         zy += cy;
+
+        if ( fabs( zx - px ) + fabs( zy - py ) <= tolerance )
+            return 0.0;
+
+        if ( k == checkpoint ) {
+            px = zx;
+            py = zy;
+            interval *= 2;
+            checkpoint -= interval;
+        }
     }
 
     return 0.0;
 }
 
-class MandelbrotFastParams
-{
-public:
-    MandelbrotFastParams()
-    {
-    }
-};
-
 template<int N, Variant VARIANT>
 class MandelbrotFastFunctor : public Functor, public MandelbrotFastParams
 {
@@ -302,24 +266,31 @@ public:
     {
     }
 
-    double operator()( double zx, double zy, int maxIterations )
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
     {
-        return calculateFast<N, VARIANT>( zx, zy, zx, zy, maxIterations );
+        for ( int i = 0; i < count && !isCancelled( m_cancellation ); i++ ) {
+            double x = zx[ i ];
+            double y = zy[ i ];
+            int k = maxIterations;
+            if ( N == 2 && VARIANT == NormalVariant && isInsideMainBulbs( x, y ) )
+                result[ i ] = 0.0;
+            else
+                result[ i ] = calculateFast<N, VARIANT>( x, y, zx[ i ], zy[ i ], m_tolerance, maxIterations, k );
+        }
     }
-};
 
-class JuliaFastParams : public MandelbrotFastParams
-{
-public:
-    JuliaFastParams( double cx, double cy ) : MandelbrotFastParams(),
-        m_cx( cx ),
-        m_cy( cy )
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
     {
+        for ( int i = 0; i < count && !isCancelled( m_cancellation ); i++ ) {
+            int k = resumeState( state, i, x[ i ], y[ i ], maxIterations );
+            if ( N == 2 && VARIANT == NormalVariant && isInsideMainBulbs( x[ i ], y[ i ] ) )
+                result[ i ] = 0.0;
+            else
+                result[ i ] = calculateFast<N, VARIANT>( state.m_zx[ i ], state.m_zy[ i ], x[ i ], y[ i ], m_tolerance, maxIterations, k );
+            state.m_iterations[ i ] = maxIterations - k;
+        }
+        return true;
     }
-
-protected:
-    double m_cx;
-    double m_cy;
 };
 
 template<int N, Variant VARIANT>
@@ -330,132 +301,240 @@ public:
     {
     }
 
-    double operator()( double zx, double zy, int maxIterations )
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
     {
-        return calculateFast<N, VARIANT>( zx, zy, m_cx, m_cy, maxIterations );
+        for ( int i = 0; i < count && !isCancelled( m_cancellation ); i++ ) {
+            double x = zx[ i ];
+            double y = zy[ i ];
+            int k = maxIterations;
+            result[ i ] = calculateFast<N, VARIANT>( x, y, m_cx, m_cy, m_tolerance, maxIterations, k );
+        }
     }
 
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
+    {
+        for ( int i = 0; i < count && !isCancelled( m_cancellation ); i++ ) {
+            int k = resumeState( state, i, x[ i ], y[ i ], maxIterations );
+            result[ i ] = calculateFast<N, VARIANT>( state.m_zx[ i ], state.m_zy[ i ], m_cx, m_cy, m_tolerance, maxIterations, k );
+            state.m_iterations[ i ] = maxIterations - k;
+        }
+        return true;
+    }
 };
 
-template<typename BASE, template<int N, Variant VARIANT> class FACTORY, int EXPONENT = MaxExponent>
-class ExponentDispatcher
+Functor* createMandelbrotFastFunctor( int exponent, Variant variant, double tolerance )
 {
-public:
-    template<typename PARAMS>
-    static BASE* create( int exponent, Variant variant, const PARAMS& params )
-    {
-        if ( exponent == EXPONENT )
-            return VariantDispatcher<BASE, FactoryAdapter>::create( variant, params );
-        return ExponentDispatcher<BASE, FACTORY, EXPONENT - 1>::create( exponent, variant, params );
+    return FastFunctorFactory<Functor, MandelbrotFastFunctor>::create( exponent, variant, MandelbrotFastParams( tolerance ) );
+}
+
+Functor* createJuliaFastFunctor( double cx, double cy, int exponent, Variant variant, double tolerance )
+{
+    return FastFunctorFactory<Functor, JuliaFastFunctor>::create( exponent, variant, JuliaFastParams( cx, cy, tolerance ) );
+}
+
+template<Variant VARIANT>
+static inline void adjustDoubleDouble( DoubleDouble& zx, DoubleDouble& zy )
+{
+    switch ( VARIANT ) {
+        case NormalVariant:
+            break;
+        case ConjugateVariant:
+            zy = -zy;
+            break;
+        case AbsoluteVariant:
+            if ( zx.m_hi < 0.0 )
+                zx = -zx;
+            if ( zy.m_hi < 0.0 )
+                zy = -zy;
+            break;
+        case AbsoluteImVariant:
+            if ( zy.m_hi < 0.0 )
+                zy = -zy;
+            break;
     }
+}
 
-private:
-    template<Variant VARIANT>
-    class FactoryAdapter
-    {
-    public:
-        template<typename PARAMS>
-        static BASE* create( const PARAMS& params )
-        {
-            return FACTORY<EXPONENT, VARIANT>::create( params );
-        }
-    };
-};
+template<int N, Variant VARIANT>
+static double calculateDoubleDouble( const DoubleDouble& x, const DoubleDouble& y, const DoubleDouble& cx, const DoubleDouble& cy, int maxIterations )
+{
+    DoubleDouble zx = x;
+    DoubleDouble zy = y;
+
+    for ( int k = maxIterations; k > 0; k-- ) {
+        adjustDoubleDouble<VARIANT>( zx, zy );
+
+        // the low parts are irrelevant for the bailout test
+        double radius = zx.m_hi * zx.m_hi + zy.m_hi * zy.m_hi;
+
+        if ( radius >= BailoutRadius )
+            return calculateResult( maxIterations, k, radius, N );
+
+        DoubleDoublePower<N>::calculate( zx, zy );
+
+        zx = zx + cx;
+        zy = zy + cy;
+    }
 
-template<typename BASE, template<int N, Variant VARIANT> class FACTORY>
-class ExponentDispatcher<BASE, FACTORY, 1>
+    return 0.0;
+}
+
+template<int N, Variant VARIANT>
+class MandelbrotDoubleDoubleFunctor : public Functor, public DoubleDoubleParams
 {
 public:
-    template<typename PARAMS>
-    static BASE* create( int /*exponent*/, Variant /*variant*/, const PARAMS& /*params*/ )
+    MandelbrotDoubleDoubleFunctor( const DoubleDoubleParams& params ) : DoubleDoubleParams( params )
     {
-        return NULL;
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        for ( int i = 0; i < count && !isCancelled( m_cancellation ); i++ ) {
+            DoubleDouble x = m_x + zx[ i ];
+            DoubleDouble y = m_y + zy[ i ];
+            result[ i ] = calculateDoubleDouble<N, VARIANT>( x, y, x, y, maxIterations );
+        }
     }
 };
 
-template<typename BASE, template<int N, Variant VARIANT> class FUNCTOR>
-class FastFunctorFactory
+template<int N, Variant VARIANT>
+class JuliaDoubleDoubleFunctor : public Functor, public JuliaDoubleDoubleParams
 {
 public:
-    template<typename PARAMS>
-    static BASE* create( int exponent, Variant variant, const PARAMS& params )
+    JuliaDoubleDoubleFunctor( const JuliaDoubleDoubleParams& params ) : JuliaDoubleDoubleParams( params )
     {
-        return ExponentDispatcher<BASE, InnerFactory>::create( exponent, variant, params );
     }
 
-private:
-    template<int N, Variant VARIANT>
-    class InnerFactory
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
     {
-    public:
-        template<typename PARAMS>
-        static BASE* create( const PARAMS& params )
-        {
-            return new FUNCTOR<N, VARIANT>( params );
-        }
-    };
+        DoubleDouble cx = { m_cx, 0.0 };
+        DoubleDouble cy = { m_cy, 0.0 };
+        for ( int i = 0; i < count && !isCancelled( m_cancellation ); i++ )
+            result[ i ] = calculateDoubleDouble<N, VARIANT>( m_x + zx[ i ], m_y + zy[ i ], cx, cy, maxIterations );
+    }
 };
 
-Functor* createMandelbrotFastFunctor( int exponent, Variant variant )
+Functor* createMandelbrotDoubleDoubleFunctor( const FixedPoint& x, const FixedPoint& y, int exponent, Variant variant )
 {
-    return FastFunctorFactory<Functor, MandelbrotFastFunctor>::create( exponent, variant, MandelbrotFastParams() );
+    return FastFunctorFactory<Functor, MandelbrotDoubleDoubleFunctor>::create( exponent, variant, DoubleDoubleParams( x, y ) );
 }
 
-Functor* createJuliaFastFunctor( double cx, double cy, int exponent, Variant variant )
+Functor* createJuliaDoubleDoubleFunctor( const FixedPoint& x, const FixedPoint& y, double cx, double cy, int exponent, Variant variant )
 {
-    return FastFunctorFactory<Functor, JuliaFastFunctor>::create( exponent, variant, JuliaFastParams( cx, cy ) );
+    return FastFunctorFactory<Functor, JuliaDoubleDoubleFunctor>::create( exponent, variant, JuliaDoubleDoubleParams( x, y, cx, cy ) );
 }
 
-void generatePreview( const Input& input, const Output& output, Functor* functor, int maxIterations )
+PointQueue::PointQueue( const Output& output ) :
+    m_zx( NULL ),
+    m_zy( NULL ),
+    m_result( NULL ),
+    m_targets( NULL ),
+    m_continuation( output.m_continuation ),
+    m_base( output.m_buffer ),
+    m_stateX( NULL ),
+    m_stateY( NULL ),
+    m_iterations( NULL ),
+    m_reference( NULL ),
+    m_count( 0 ),
+    m_capacity( 0 )
 {
-    for ( int y = 0; y < output.m_height; y += CellSize ) {
-        double* row = output.m_buffer + output.m_stride * y;
-        for ( int x = 0; x < output.m_width; x += CellSize ) {
-            double zx = input.m_x + input.m_ca * x + input.m_sa * y;
-            double zy = input.m_y - input.m_sa * x + input.m_ca * y;
-            row[ x ] = ( *functor )( zx, zy, maxIterations );
-        }
-    }
 }
 
-static inline bool checkThreshold( double p1, double p2, double threshold )
+PointQueue::~PointQueue()
 {
-    double pmin, pmax;
-    if ( p1 < p2 )
-        pmin = p1, pmax = p2;
-    else
-        pmin = p2, pmax = p1;
+    delete[] m_zx;
+    delete[] m_zy;
+    delete[] m_result;
+    delete[] m_targets;
+
+    delete[] m_stateX;
+    delete[] m_stateY;
+    delete[] m_iterations;
+    delete[] m_reference;
+}
 
-    if ( pmin == 0.0 && pmax != 0.0 )
-        return true;
-    
-    if ( ( pmax - pmin ) > threshold )
-        return true;
+void PointQueue::add( double zx, double zy, double* target )
+{
+    if ( m_count == m_capacity )
+        grow();
+
+    m_zx[ m_count ] = zx;
+    m_zy[ m_count ] = zy;
+    m_targets[ m_count ] = target;
+    m_count++;
+}
+
+void PointQueue::grow()
+{
+    int capacity = qMax( 2 * m_capacity, 256 );
+
+    double* zx = new double[ capacity ];
+    double* zy = new double[ capacity ];
+    double** targets = new double*[ capacity ];
+
+    for ( int i = 0; i < m_count; i++ ) {
+        zx[ i ] = m_zx[ i ];
+        zy[ i ] = m_zy[ i ];
+        targets[ i ] = m_targets[ i ];
+    }
 
-    return false;
+    delete[] m_zx;
+    delete[] m_zy;
+    delete[] m_result;
+    delete[] m_targets;
+
+    m_zx = zx;
+    m_zy = zy;
+    m_result = new double[ capacity ];
+    m_targets = targets;
+
+    // the state is only needed during the calculation
+    if ( m_continuation ) {
+        delete[] m_stateX;
+        delete[] m_stateY;
+        delete[] m_iterations;
+        delete[] m_reference;
+
+        m_stateX = new double[ capacity ];
+        m_stateY = new double[ capacity ];
+        m_iterations = new int[ capacity ];
+        m_reference = new int[ capacity ];
+    }
+
+    m_capacity = capacity;
 }
 
-static inline bool checkThreshold( double p1, double p2, double p3, double p4, double threshold )
+// points which are already calculated are not queued again
+static inline void queueUnknown( const Output& output, double zx, double zy, double* target, PointQueue* queue )
 {
-    return checkThreshold( p1, p2, threshold )
-        || checkThreshold( p3, p4, threshold )
-        || checkThreshold( p1, p3, threshold )
-        || checkThreshold( p2, p4, threshold );
+    if ( !output.m_known || !output.m_known[ target - output.m_buffer ] )
+        queue->add( zx, zy, target );
 }
 
-void generateDetails( const Input& input, const Output& output, Functor* functor, int maxIterations, double threshold )
+// the coordinates of a row are calculated relative to its first point; they
+// are not accumulated, which would make the rounding errors grow along the row
+void queuePreview( const Input& input, const Output& output, PointQueue* queue )
+{
+    for ( int y = 0; y < output.m_height; y += CellSize ) {
+        double* row = output.m_buffer + output.m_stride * y;
+        double rx = input.m_x + input.m_sa * y;
+        double ry = input.m_y + input.m_ca * y;
+        for ( int x = 0; x < output.m_width; x += CellSize )
+            queueUnknown( output, rx + input.m_ca * x, ry - input.m_sa * x, &row[ x ], queue );
+    }
+}
+
+void queueDetails( const Input& input, const Output& output, double threshold, PointQueue* queue )
 {
     for ( int y = 0; y < output.m_height; y += CellSize ) {
         double* row = output.m_buffer + output.m_stride * y;
+        double rx = input.m_x + input.m_sa * y;
+        double ry = input.m_y + input.m_ca * y;
         for ( int x = 0; x < output.m_width - CellSize; x += CellSize ) {
             double p1 = row[ x ];
             double p2 = row[ x + CellSize ];
             if ( checkThreshold( p1, p2, threshold ) ) {
-                for ( int i = 1; i < CellSize; i++ ) {
-                    double zx = input.m_x + input.m_ca * ( x + i ) + input.m_sa * y;
-                    double zy = input.m_y - input.m_sa * ( x + i ) + input.m_ca * y;
-                    row[ x + i ] = ( *functor )( zx, zy, maxIterations );
-                }
+                for ( int i = 1; i < CellSize; i++ )
+                    queueUnknown( output, rx + input.m_ca * ( x + i ), ry - input.m_sa * ( x + i ), &row[ x + i ], queue );
             }
         }
     }
@@ -467,9 +546,9 @@ void generateDetails( const Input& input, const Output& output, Functor* functor
             double p2 = row[ output.m_stride * CellSize + x ];
             if ( checkThreshold( p1, p2, threshold ) ) {
                 for ( int i = 1; i < CellSize; i++ ) {
-                    double zx = input.m_x + input.m_ca * x + input.m_sa * ( y + i );
-                    double zy = input.m_y - input.m_sa * x + input.m_ca * ( y + i );
-                    row[ output.m_stride * i + x ] = ( *functor )( zx, zy, maxIterations );
+                    double rx = input.m_x + input.m_sa * ( y + i );
+                    double ry = input.m_y + input.m_ca * ( y + i );
+                    queueUnknown( output, rx + input.m_ca * x, ry - input.m_sa * x, &row[ output.m_stride * i + x ], queue );
                 }
             }
         }
@@ -484,408 +563,717 @@ void generateDetails( const Input& input, const Output& output, Functor* functor
             double p4 = row[ output.m_stride * CellSize + x + CellSize ];
             if ( checkThreshold( p1, p2, p3, p4, threshold ) ) {
                 for ( int i = 1; i < CellSize; i++ ) {
-                    for ( int j = 1; j < CellSize; j++ ) {
-                        double zx = input.m_x + input.m_ca * ( x + j ) + input.m_sa * ( y + i );
-                        double zy = input.m_y - input.m_sa * ( x + j ) + input.m_ca * ( y + i );
-                        row[ output.m_stride * i + x + j ] = ( *functor )( zx, zy, maxIterations );
-                    }
+                    double rx = input.m_x + input.m_sa * ( y + i );
+                    double ry = input.m_y + input.m_ca * ( y + i );
+                    for ( int j = 1; j < CellSize; j++ )
+                        queueUnknown( output, rx + input.m_ca * ( x + j ), ry - input.m_sa * ( x + j ), &row[ output.m_stride * i + x + j ], queue );
                 }
             }
         }
     }
 }
 
-void interpolate( const Output& output )
+RectangleSubdivision::RectangleSubdivision( const Input& input, const Output& output, double threshold, bool verify ) :
+    m_input( input ),
+    m_output( output ),
+    m_threshold( threshold ),
+    m_verify( verify )
 {
-    for ( int y = 0; y < output.m_height; y += CellSize ) {
-        double* row = output.m_buffer + output.m_stride * y;
-        for ( int x = 0; x < output.m_width - CellSize; x += CellSize ) {
-            double p1 = row[ x ];
-            double p2 = row[ x + CellSize ];
-            for ( int i = 1; i < CellSize; i++ )
-                row[ x + i ] = (double)( CellSize - i ) / (double)CellSize * p1 + (double)i / (double)CellSize * p2;
-        }
-    }
-    for ( int y = 0; y < output.m_height - CellSize; y += CellSize ) {
-        double* row = output.m_buffer + output.m_stride * y;
-        for ( int x = 0; x < output.m_width; x++ ) {
-            double p1 = row[ x ];
-            double p2 = row[ output.m_stride * CellSize + x ];
-            for ( int i = 1; i < CellSize; i++ )
-                row[ output.m_stride * i + x ] = (double)( CellSize - i ) / (double)CellSize * p1 + (double)i / (double)CellSize * p2;
-        }
+    m_known = new bool[ output.m_width * output.m_height ];
+    for ( int y = 0; y < output.m_height; y++ ) {
+        for ( int x = 0; x < output.m_width; x++ )
+            m_known[ y * output.m_width + x ] = output.m_known && output.m_known[ y * output.m_stride + x ];
     }
-}
-
-#if defined( HAVE_SSE2 )
-
-#if defined( Q_CC_MSVC )
-# define ALIGNXMM( var ) __declspec(align(16)) var
-#else
-# define ALIGNXMM( var ) var __attribute__((aligned(16)))
-#endif
-
-enum CPUFeatures
-{
-    MMX = 1,
-    SSE = 2,
-    SSE2 = 4
-};
 
-// based on qdrawhelper.cpp
-static int detectCPUFeatures()
-{
-#if defined( __x86_64__ ) || defined( __ia64__ ) || defined( Q_OS_WIN64 )
-    return MMX | SSE | SSE2;
-#elif defined( __i386__ ) || defined( _M_IX86 )
-    int result = 0;
-#if defined( Q_CC_GNU )
-    asm( "push %%ebx\n"
-         "pushf\n"
-         "pop %%eax\n"
-         "mov %%eax, %%ebx\n"
-         "xor $0x00200000, %%eax\n"
-         "push %%eax\n"
-         "popf\n"
-         "pushf\n"
-         "pop %%eax\n"
-         "xor %%edx, %%edx\n"
-         "xor %%ebx, %%eax\n"
-         "jz 1f\n"
-         "mov $0x00000001, %%eax\n"
-         "cpuid\n"
-         "1:\n"
-         "pop %%ebx\n"
-         "mov %%edx, %0\n"
-        : "=r" ( result )
-        :
-        : "%eax", "%ecx", "%edx"
-        );
-#elif defined ( Q_OS_WIN )
-    _asm {
-        push eax
-        push ebx
-        push ecx
-        push edx
-        pushfd
-        pop eax
-        mov ebx, eax
-        xor eax, 00200000h
-        push eax
-        popfd
-        pushfd
-        pop eax
-        mov edx, 0
-        xor eax, ebx
-        jz skip
-        mov eax, 1
-        cpuid
-        mov result, edx
-    skip:
-        pop edx
-        pop ecx
-        pop ebx
-        pop eax
-    }
-#endif
-    int features = 0;
-    if ( result & ( 1 << 23 ) )
-        features |= MMX;
-    if ( result & ( 1 << 25 ) )
-        features |= SSE;
-    if ( result & ( 1 << 26 ) )
-        features |= SSE2;
-    return features;
-#else
-    return 0;
-#endif
+    m_pending.append( QRect( 0, 0, output.m_width, output.m_height ) );
 }
 
-static const int AvailableCPUFeatures = detectCPUFeatures();
-
-bool isSSE2Available()
+RectangleSubdivision::~RectangleSubdivision()
 {
-    return AvailableCPUFeatures & SSE2;
+    delete[] m_known;
 }
 
-template<int N>
-static inline void calculatePowerSSE2( __m128d& zx, __m128d& zy, __m128d& radius )
+bool RectangleSubdivision::queuePoints( PointQueue* queue )
 {
-    if ( N % 2 == 0 ) {
-        calculatePowerSSE2<N / 2>( zx, zy, radius );
-
-        __m128d zxx = _mm_mul_pd( zx, zx );
-        __m128d zyy = _mm_mul_pd( zy, zy );
-        __m128d zxy = _mm_mul_pd( zx, zy );
+    for ( int i = 0; i < m_verified.count(); i++ ) {
+        if ( isUniform( m_verified[ i ], true ) )
+            fill( m_verified[ i ] );
+        else
+            split( m_verified[ i ] );
+    }
+    m_verified.clear();
+
+    // rectangles smaller than 3x3 have no points inside the perimeter
+    for ( int i = 0; i < m_queued.count(); i++ ) {
+        const QRect& rect = m_queued[ i ];
+        if ( rect.width() < 3 || rect.height() < 3 )
+            continue;
+
+        if ( !isUniform( rect, false ) ) {
+            split( rect );
+        } else if ( m_verify ) {
+            queueCross( rect, queue );
+            m_verified.append( rect );
+        } else {
+            fill( rect );
+        }
+    }
+    m_queued.clear();
 
-        zx = _mm_sub_pd( zxx, zyy );
-        zy = _mm_add_pd( zxy, zxy );
-    } else {
-        __m128d zx2 = zx;
-        __m128d zy2 = zy;
-        calculatePowerSSE2<N - 1>( zx2, zy2, radius );
+    if ( !m_verified.isEmpty() )
+        return true;
 
-        __m128d zxx2 = _mm_mul_pd( zx, zx2 );
-        __m128d zxy2 = _mm_mul_pd( zx, zy2 );
-        __m128d zyx2 = _mm_mul_pd( zy, zx2 );
-        __m128d zyy2 = _mm_mul_pd( zy, zy2 );
+    if ( m_pending.isEmpty() )
+        return false;
 
-        zx = _mm_sub_pd( zxx2, zyy2 );
-        zy = _mm_add_pd( zxy2, zyx2 );
-    }
-}
+    for ( int i = 0; i < m_pending.count(); i++ )
+        queuePerimeter( m_pending[ i ], queue );
 
-template<>
-inline void calculatePowerSSE2<2>( __m128d& zx, __m128d& zy, __m128d& radius )
-{
-    __m128d zxx = _mm_mul_pd( zx, zx );
-    __m128d zyy = _mm_mul_pd( zy, zy );
-    __m128d zxy = _mm_mul_pd( zx, zy );
+    m_queued = m_pending;
+    m_pending.clear();
 
-    zx = _mm_sub_pd( zxx, zyy );
-    zy = _mm_add_pd( zxy, zxy );
-    radius = _mm_add_pd( zxx, zyy );
+    return true;
 }
 
-template<>
-inline void calculatePowerSSE2<1>( __m128d& /*zx*/, __m128d& /*zy*/, __m128d& /*radius*/ )
+void RectangleSubdivision::queuePoint( int x, int y, PointQueue* queue )
 {
-}
+    int index = y * m_output.m_width + x;
+    if ( m_known[ index ] )
+        return;
 
-template<Variant VARIANT>
-static void adjustSSE2( __m128d& /*zx*/, __m128d& /*zy*/ );
+    m_known[ index ] = true;
 
-template<>
-inline void adjustSSE2<NormalVariant>( __m128d& /*zx*/, __m128d& /*zy*/ )
-{
+    double zx = m_input.m_x + m_input.m_sa * y + m_input.m_ca * x;
+    double zy = m_input.m_y + m_input.m_ca * y - m_input.m_sa * x;
+    queue->add( zx, zy, &m_output.m_buffer[ y * m_output.m_stride + x ] );
 }
 
-template<>
-inline void adjustSSE2<ConjugateVariant>( __m128d& /*zx*/, __m128d& zy )
+void RectangleSubdivision::queuePerimeter( const QRect& rect, PointQueue* queue )
 {
-    __m128d mask = _mm_castsi128_pd( _mm_set_epi32( int( 0x80000000 ), 0, int( 0x80000000 ), 0 ) );
-    zy = _mm_xor_pd( mask, zy );
+    for ( int x = rect.left(); x <= rect.right(); x++ ) {
+        queuePoint( x, rect.top(), queue );
+        queuePoint( x, rect.bottom(), queue );
+    }
+    for ( int y = rect.top() + 1; y < rect.bottom(); y++ ) {
+        queuePoint( rect.left(), y, queue );
+        queuePoint( rect.right(), y, queue );
+    }
 }
 
-template<>
-inline void adjustSSE2<AbsoluteVariant>( __m128d& zx, __m128d& zy )
+void RectangleSubdivision::queueCross( const QRect& rect, PointQueue* queue )
 {
-    __m128d mask = _mm_castsi128_pd( _mm_set_epi32( 0x7fffffff, int( 0xffffffff ), 0x7fffffff, int( 0xffffffff ) ) );
-    zx = _mm_and_pd( zx, mask );
-    zy = _mm_and_pd( zy, mask );
+    QPoint center = rect.center();
+    for ( int x = rect.left() + 1; x < rect.right(); x++ )
+        queuePoint( x, center.y(), queue );
+    for ( int y = rect.top() + 1; y < rect.bottom(); y++ )
+        queuePoint( center.x(), y, queue );
 }
 
-template<>
-inline void adjustSSE2<AbsoluteImVariant>( __m128d& /*zx*/, __m128d& zy )
+bool RectangleSubdivision::isUniform( const QRect& rect, bool cross ) const
 {
-    __m128d mask = _mm_castsi128_pd( _mm_set_epi32( 0x7fffffff, int( 0xffffffff ), 0x7fffffff, int( 0xffffffff ) ) );
-    zy = _mm_and_pd( zy, mask );
-}
+    const double* buffer = m_output.m_buffer;
+    int stride = m_output.m_stride;
 
-template<int N, Variant VARIANT>
-static inline bool calculateStepSSE2( int k, __m128d& zx, __m128d& zy, __m128d cx, __m128d cy, __m128d rmax, int count[], double final[] )
-{
-    adjustSSE2<VARIANT>( zx, zy );
+    double pmin = buffer[ rect.top() * stride + rect.left() ];
+    double pmax = pmin;
 
-    __m128d radius;
-    calculatePowerSSE2<N>( zx, zy, radius );
-
-    int mask = _mm_movemask_pd( _mm_cmpge_pd( radius, rmax ) );
+    for ( int x = rect.left(); x <= rect.right(); x++ ) {
+        double p1 = buffer[ rect.top() * stride + x ];
+        double p2 = buffer[ rect.bottom() * stride + x ];
+        pmin = qMin( pmin, qMin( p1, p2 ) );
+        pmax = qMax( pmax, qMax( p1, p2 ) );
+    }
+    for ( int y = rect.top(); y <= rect.bottom(); y++ ) {
+        double p1 = buffer[ y * stride + rect.left() ];
+        double p2 = buffer[ y * stride + rect.right() ];
+        pmin = qMin( pmin, qMin( p1, p2 ) );
+        pmax = qMax( pmax, qMax( p1, p2 ) );
+    }
 
-    zx = _mm_add_pd( zx, cx );
-    zy = _mm_add_pd( zy, cy );
+    if ( cross ) {
+        QPoint center = rect.center();
+        for ( int x = rect.left(); x <= rect.right(); x++ ) {
+            double p = buffer[ center.y() * stride + x ];
+            pmin = qMin( pmin, p );
+            pmax = qMax( pmax, p );
+        }
+        for ( int y = rect.top(); y <= rect.bottom(); y++ ) {
+            double p = buffer[ y * stride + center.x() ];
+            pmin = qMin( pmin, p );
+            pmax = qMax( pmax, p );
+        }
+    }
 
-    if ( mask ) {
-        if ( mask & 1 ) {
-            if ( !count[ 0 ] ) {
-                count[ 0 ] = k;
-                _mm_storel_pd( &final[ 0 ], radius );
+    return !checkThreshold( pmin, pmax, m_threshold );
+}
 
-                if ( count[ 1 ] )
-                    return true;
-            }
+void RectangleSubdivision::fill( const QRect& rect )
+{
+    double* buffer = m_output.m_buffer;
+    int stride = m_output.m_stride;
+
+    int left = rect.left();
+    int top = rect.top();
+    int right = rect.right();
+    int bottom = rect.bottom();
+
+    double p1 = buffer[ top * stride + left ];
+    double p2 = buffer[ top * stride + right ];
+    double p3 = buffer[ bottom * stride + left ];
+    double p4 = buffer[ bottom * stride + right ];
+
+    // blend the linear interpolations between opposite edges (a Coons patch),
+    // which results in zero for an interior rectangle; the points calculated
+    // when verifying the rectangle are not modified
+    for ( int y = top + 1; y < bottom; y++ ) {
+        double v = (double)( y - top ) / (double)( bottom - top );
+        double* row = buffer + y * stride;
+        for ( int x = left + 1; x < right; x++ ) {
+            if ( m_known[ y * m_output.m_width + x ] )
+                continue;
+            double u = (double)( x - left ) / (double)( right - left );
+            double horizontal = ( 1.0 - u ) * row[ left ] + u * row[ right ];
+            double vertical = ( 1.0 - v ) * buffer[ top * stride + x ] + v * buffer[ bottom * stride + x ];
+            double corners = ( 1.0 - v ) * ( ( 1.0 - u ) * p1 + u * p2 ) + v * ( ( 1.0 - u ) * p3 + u * p4 );
+            row[ x ] = horizontal + vertical - corners;
         }
-        if ( mask & 2 ) {
-            if ( !count[ 1 ] ) {
-                count[ 1 ] = k;
-                _mm_storeh_pd( &final[ 1 ], radius );
+    }
+}
 
-                if ( count[ 0 ] )
-                    return true;
-            }
+void RectangleSubdivision::split( const QRect& rect )
+{
+    QPoint center = rect.center();
+
+    m_pending.append( QRect( rect.topLeft(), center ) );
+    m_pending.append( QRect( QPoint( center.x(), rect.top() ), QPoint( rect.right(), center.y() ) ) );
+    m_pending.append( QRect( QPoint( rect.left(), center.y() ), QPoint( center.x(), rect.bottom() ) ) );
+    m_pending.append( QRect( center, rect.bottomRight() ) );
+}
+
+QuadtreeRefinement::QuadtreeRefinement( const Input& input, const Output& output, double threshold ) :
+    m_input( input ),
+    m_output( output ),
+    m_threshold( threshold )
+{
+    m_known = new bool[ output.m_width * output.m_height ];
+    for ( int y = 0; y < output.m_height; y++ ) {
+        for ( int x = 0; x < output.m_width; x++ )
+            m_known[ y * output.m_width + x ] = output.m_known && output.m_known[ y * output.m_stride + x ];
+    }
+
+    // the cells at the right and bottom edge may be smaller
+    for ( int y = 0; y < qMax( output.m_height - 1, 1 ); y += QuadtreeCellSize ) {
+        for ( int x = 0; x < qMax( output.m_width - 1, 1 ); x += QuadtreeCellSize ) {
+            QPoint bottomRight( qMin( x + QuadtreeCellSize, output.m_width - 1 ), qMin( y + QuadtreeCellSize, output.m_height - 1 ) );
+            m_pending.append( QRect( QPoint( x, y ), bottomRight ) );
         }
     }
+}
 
-    return false;
+QuadtreeRefinement::~QuadtreeRefinement()
+{
+    delete[] m_known;
 }
 
-template<int N, Variant VARIANT, int STEPS>
-class RepeatStepsSSE2
+bool QuadtreeRefinement::queuePoints( PointQueue* queue )
 {
-public:
-    static inline bool calculate( int k, __m128d& zx, __m128d& zy, __m128d cx, __m128d cy, __m128d rmax, int count[], double final[] )
-    {
-        if ( calculateStepSSE2<N, VARIANT>( k, zx, zy, cx, cy, rmax, count, final ) )
-            return true;
+    const double* buffer = m_output.m_buffer;
+    int stride = m_output.m_stride;
+
+    for ( int i = 0; i < m_queued.count(); i++ ) {
+        const QRect& cell = m_queued[ i ];
+
+        // all points of a cell of 2x2 pixels are its corners
+        if ( cell.width() <= 2 && cell.height() <= 2 )
+            continue;
+
+        double p1 = buffer[ cell.top() * stride + cell.left() ];
+        double p2 = buffer[ cell.top() * stride + cell.right() ];
+        double p3 = buffer[ cell.bottom() * stride + cell.left() ];
+        double p4 = buffer[ cell.bottom() * stride + cell.right() ];
 
-        if ( RepeatStepsSSE2<N, VARIANT, STEPS - 1>::calculate( k - 1, zx, zy, cx, cy, rmax, count, final ) )
-            return true;
+        // filaments of the set are easily missed by the corners, so cells
+        // which touch the set are split until they are small enough
+        bool interior = ( p1 == 0.0 || p2 == 0.0 || p3 == 0.0 || p4 == 0.0 );
 
+        if ( checkThreshold( p1, p2, p3, p4, m_threshold ) || ( interior && qMax( cell.width(), cell.height() ) > 5 ) )
+            split( cell );
+        else
+            fill( cell );
+    }
+    m_queued.clear();
+
+    if ( m_pending.isEmpty() )
         return false;
+
+    for ( int i = 0; i < m_pending.count(); i++ ) {
+        const QRect& cell = m_pending[ i ];
+        queuePoint( cell.left(), cell.top(), queue );
+        queuePoint( cell.right(), cell.top(), queue );
+        queuePoint( cell.left(), cell.bottom(), queue );
+        queuePoint( cell.right(), cell.bottom(), queue );
     }
 
-    static const int Steps = STEPS;
-};
+    m_queued = m_pending;
+    m_pending.clear();
 
-template<int N, Variant VARIANT>
-class RepeatStepsSSE2<N, VARIANT, 0>
+    return true;
+}
+
+void QuadtreeRefinement::queuePoint( int x, int y, PointQueue* queue )
 {
-public:
-    static inline bool calculate( int /*k*/, __m128d& /*zx*/, __m128d& /*zy*/, __m128d /*cx*/, __m128d /*cy*/, __m128d /*rmax*/, int /*count*/[], double /*final*/[] )
-    {
-        return false;
+    int index = y * m_output.m_width + x;
+    if ( m_known[ index ] )
+        return;
+
+    m_known[ index ] = true;
+
+    double zx = m_input.m_x + m_input.m_sa * y + m_input.m_ca * x;
+    double zy = m_input.m_y + m_input.m_ca * y - m_input.m_sa * x;
+    queue->add( zx, zy, &m_output.m_buffer[ y * m_output.m_stride + x ] );
+}
+
+void QuadtreeRefinement::fill( const QRect& cell )
+{
+    double* buffer = m_output.m_buffer;
+    int stride = m_output.m_stride;
+
+    int left = cell.left();
+    int top = cell.top();
+    int right = cell.right();
+    int bottom = cell.bottom();
+
+    double p1 = buffer[ top * stride + left ];
+    double p2 = buffer[ top * stride + right ];
+    double p3 = buffer[ bottom * stride + left ];
+    double p4 = buffer[ bottom * stride + right ];
+
+    // the edges are shared with the neighboring cells, so points which were
+    // calculated by a neighbor are not modified
+    for ( int y = top; y <= bottom; y++ ) {
+        double v = ( bottom > top ) ? (double)( y - top ) / (double)( bottom - top ) : 0.0;
+        double* row = buffer + y * stride;
+        for ( int x = left; x <= right; x++ ) {
+            if ( m_known[ y * m_output.m_width + x ] )
+                continue;
+            double u = ( right > left ) ? (double)( x - left ) / (double)( right - left ) : 0.0;
+            row[ x ] = ( 1.0 - v ) * ( ( 1.0 - u ) * p1 + u * p2 ) + v * ( ( 1.0 - u ) * p3 + u * p4 );
+        }
     }
-};
+}
 
-template<int N, Variant VARIANT>
-class AutoStepsSSE2 : public RepeatStepsSSE2<N, VARIANT, ( N <= 5 ) ? 2 : 1>
+void QuadtreeRefinement::split( const QRect& cell )
 {
-};
+    QPoint center = cell.center();
+
+    // a cell which is only two pixels wide or high is split in one direction
+    if ( cell.width() <= 2 ) {
+        m_pending.append( QRect( cell.topLeft(), QPoint( cell.right(), center.y() ) ) );
+        m_pending.append( QRect( QPoint( cell.left(), center.y() ), cell.bottomRight() ) );
+    } else if ( cell.height() <= 2 ) {
+        m_pending.append( QRect( cell.topLeft(), QPoint( center.x(), cell.bottom() ) ) );
+        m_pending.append( QRect( QPoint( center.x(), cell.top() ), cell.bottomRight() ) );
+    } else {
+        m_pending.append( QRect( cell.topLeft(), center ) );
+        m_pending.append( QRect( QPoint( center.x(), cell.top() ), QPoint( cell.right(), center.y() ) ) );
+        m_pending.append( QRect( QPoint( cell.left(), center.y() ), QPoint( center.x(), cell.bottom() ) ) );
+        m_pending.append( QRect( center, cell.bottomRight() ) );
+    }
+}
 
-template<int N, Variant VARIANT>
-static inline void calculateSSE2( double result[], double x[], double y[], double cx[], double cy[], int maxIterations )
+void generatePreview( const Input& input, const Output& output, Functor* functor, int maxIterations )
+{
+    PointQueue queue( output );
+    queuePreview( input, output, &queue );
+    queue.calculate( functor, maxIterations );
+}
+
+void generateDetails( const Input& input, const Output& output, Functor* functor, int maxIterations, double threshold )
+{
+    // the preview is incomplete, so the details are not worth queuing
+    if ( isCancelled( functor->cancellation() ) )
+        return;
+
+    PointQueue queue( output );
+    queueDetails( input, output, threshold, &queue );
+    queue.calculate( functor, maxIterations );
+}
+
+void generateRectangles( const Input& input, const Output& output, Functor* functor, int maxIterations, double threshold, bool verify )
+{
+    PointQueue queue( output );
+    RectangleSubdivision subdivision( input, output, threshold, verify );
+    while ( !isCancelled( functor->cancellation() ) && subdivision.queuePoints( &queue ) )
+        queue.calculate( functor, maxIterations );
+}
+
+void generateQuadtree( const Input& input, const Output& output, Functor* functor, int maxIterations, double threshold )
 {
-    __m128d zx = _mm_load_pd( x );
-    __m128d zy = _mm_load_pd( y );
+    PointQueue queue( output );
+    QuadtreeRefinement refinement( input, output, threshold );
+    while ( !isCancelled( functor->cancellation() ) && refinement.queuePoints( &queue ) )
+        queue.calculate( functor, maxIterations );
+}
+
+void resumePoints( const Input& input, const Output& output, Functor* functor, int maxIterations, Continuation* continuation )
+{
+    resumeContinuation( input, output, functor, maxIterations, continuation );
+}
+
+template<typename T>
+static void growArray( T*& array, int count, int capacity )
+{
+    T* grown = new T[ capacity ];
+    for ( int i = 0; i < count; i++ )
+        grown[ i ] = array[ i ];
+    delete[] array;
+    array = grown;
+}
+
+Continuation::Continuation() :
+    m_indexes( NULL ),
+    m_zx( NULL ),
+    m_zy( NULL ),
+    m_iterations( NULL ),
+    m_reference( NULL ),
+    m_count( 0 ),
+    m_capacity( 0 )
+{
+}
+
+Continuation::~Continuation()
+{
+    delete[] m_indexes;
+    delete[] m_zx;
+    delete[] m_zy;
+    delete[] m_iterations;
+    delete[] m_reference;
+}
+
+void Continuation::append( int index, double zx, double zy, int iterations, int reference )
+{
+    if ( m_count == m_capacity ) {
+        m_capacity = qMax( 2 * m_capacity, 256 );
+        growArray( m_indexes, m_count, m_capacity );
+        growArray( m_zx, m_count, m_capacity );
+        growArray( m_zy, m_count, m_capacity );
+        growArray( m_iterations, m_count, m_capacity );
+        growArray( m_reference, m_count, m_capacity );
+    }
+
+    m_indexes[ m_count ] = index;
+    m_zx[ m_count ] = zx;
+    m_zy[ m_count ] = zy;
+    m_iterations[ m_count ] = iterations;
+    m_reference[ m_count ] = reference;
+    m_count++;
+}
+
+IterationState Continuation::state() const
+{
+    IterationState state = { m_zx, m_zy, m_iterations, m_reference };
+    return state;
+}
+
+ReferenceOrbit::ReferenceOrbit() :
+    m_points( NULL ),
+    m_length( 0 ),
+    m_capacity( 0 )
+{
+}
+
+ReferenceOrbit::~ReferenceOrbit()
+{
+    delete[] m_points;
+}
+
+void ReferenceOrbit::append( double x, double y )
+{
+    if ( m_length == m_capacity ) {
+        int capacity = qMax( 2 * m_capacity, 1024 );
+        double* points = new double[ 2 * capacity ];
+        for ( int i = 0; i < 2 * m_length; i++ )
+            points[ i ] = m_points[ i ];
+        delete[] m_points;
+        m_points = points;
+        m_capacity = capacity;
+    }
+
+    m_points[ 2 * m_length ] = x;
+    m_points[ 2 * m_length + 1 ] = y;
+    m_length++;
+}
 
-    __m128d rcx = _mm_load_pd( cx );
-    __m128d rcy = _mm_load_pd( cy ); 
+// an iteration of the orbit takes a few microseconds at the deepest zoom
+static const int OrbitCancellationSteps = 1024;
 
-    __m128d rmax = _mm_set1_pd( BailoutRadius ); 
+ReferenceOrbit* createMandelbrotOrbit( const FixedPoint& cx, const FixedPoint& cy, int exponent, Variant variant, int maxIterations,
+    const Cancellation* cancellation )
+{
+    ReferenceOrbit* orbit = new ReferenceOrbit();
+
+    FixedPoint zx;
+    FixedPoint zy;
+
+    orbit->append( 0.0, 0.0 );
+
+    for ( int k = 0; k < maxIterations; k++ ) {
+        if ( cancellation && k % OrbitCancellationSteps == 0 && cancellation->isCancelled() ) {
+            delete orbit;
+            return NULL;
+        }
+
+        switch ( variant ) {
+            case NormalVariant:
+                break;
+            case ConjugateVariant:
+                zy = -zy;
+                break;
+            case AbsoluteVariant:
+                if ( zx.isNegative() )
+                    zx = -zx;
+                if ( zy.isNegative() )
+                    zy = -zy;
+                break;
+            case AbsoluteImVariant:
+                if ( zy.isNegative() )
+                    zy = -zy;
+                break;
+        }
+
+        FixedPoint zxy = zx * zy;
+        FixedPoint px = zx * zx - zy * zy;
+        FixedPoint py = zxy + zxy;
+
+        for ( int i = 2; i < exponent; i++ ) {
+            FixedPoint t = px * zx - py * zy;
+            py = px * zy + py * zx;
+            px = t;
+        }
+
+        zx = px + cx;
+        zy = py + cy;
 
-    int count[ 2 ] = { 0, 0 };
-    double final[ 2 ] = { 0.0, 0.0 };
+        double x = zx.toDouble();
+        double y = zy.toDouble();
+        orbit->append( x, y );
 
-    for ( int k = maxIterations; k > 0; k -= AutoStepsSSE2<N, VARIANT>::Steps ) {
-        if ( AutoStepsSSE2<N, VARIANT>::calculate( k, zx, zy, rcx, rcy, rmax, count, final ) )
+        if ( x * x + y * y >= BailoutRadius )
             break;
     }
 
-    result[ 0 ] = count[ 0 ] ? calculateResult( maxIterations, count[ 0 ], final[ 0 ], N ) : 0.0;
-    result[ 1 ] = count[ 1 ] ? calculateResult( maxIterations, count[ 1 ], final[ 1 ], N ) : 0.0;
+    return orbit;
+}
+
+// calculates |c + d| - |c| without losing precision
+static inline double diffabs( double c, double d )
+{
+    if ( c >= 0.0 )
+        return ( c + d >= 0.0 ) ? d : -( 2.0 * c + d );
+    return ( c + d > 0.0 ) ? 2.0 * c + d : -d;
+}
+
+// replaces the reference point w with adjust( w ) and the difference d
+// with adjust( w + d ) - adjust( w )
+template<Variant VARIANT>
+static void adjustDelta( double& /*wx*/, double& /*wy*/, double& /*dx*/, double& /*dy*/ );
+
+template<>
+inline void adjustDelta<NormalVariant>( double& /*wx*/, double& /*wy*/, double& /*dx*/, double& /*dy*/ )
+{
+}
+
+template<>
+inline void adjustDelta<ConjugateVariant>( double& /*wx*/, double& wy, double& /*dx*/, double& dy )
+{
+    wy = -wy;
+    dy = -dy;
+}
+
+template<>
+inline void adjustDelta<AbsoluteVariant>( double& wx, double& wy, double& dx, double& dy )
+{
+    dx = diffabs( wx, dx );
+    dy = diffabs( wy, dy );
+    wx = fabs( wx );
+    wy = fabs( wy );
+}
+
+template<>
+inline void adjustDelta<AbsoluteImVariant>( double& /*wx*/, double& wy, double& /*dx*/, double& dy )
+{
+    dy = diffabs( wy, dy );
+    wy = fabs( wy );
 }
 
+// z = w + d, where w is the m-th point of the reference orbit; d, m and the
+// remaining number of iterations k are updated, so that the calculation can
+// be resumed; initially d is the point and m is 1
 template<int N, Variant VARIANT>
-class MandelbrotFunctorSSE2 : public FunctorSSE2, public MandelbrotFastParams
+static double calculatePerturbation( double& dx, double& dy, double x, double y, const ReferenceOrbit* orbit, int maxIterations, int& k, int& m )
 {
-public:
-    MandelbrotFunctorSSE2( const MandelbrotFastParams& params ) : MandelbrotFastParams( params )
-    {
+    const double* points = orbit->points();
+    int last = orbit->length() - 1;
+
+    for ( ; k > 0; k-- ) {
+        double wx = points[ 2 * m ];
+        double wy = points[ 2 * m + 1 ];
+
+        double zx = wx + dx;
+        double zy = wy + dy;
+        double radius = zx * zx + zy * zy;
+
+        if ( radius >= BailoutRadius )
+            return calculateResult( maxIterations, k, radius, N );
+
+        // when z gets closer to zero than to the reference point, d loses its
+        // precision and the image is glitched; restart from the beginning of
+        // the orbit instead, which is also necessary when the reference escapes
+        if ( m == last || radius < dx * dx + dy * dy ) {
+            dx = zx;
+            dy = zy;
+            wx = wy = 0.0;
+            m = 0;
+        }
+
+        adjustDelta<VARIANT>( wx, wy, dx, dy );
+
+        zx = wx + dx;
+        zy = wy + dy;
+
+        // z^N - w^N = d * ( z^(N-1) + z^(N-2) * w + ... + w^(N-1) )
+        double sx = 1.0;
+        double sy = 0.0;
+        double px = 1.0;
+        double py = 0.0;
+
+        for ( int i = 1; i < N; i++ ) {
+            double t = px * wx - py * wy;
+            py = px * wy + py * wx;
+            px = t;
+
+            t = sx * zx - sy * zy + px;
+            sy = sx * zy + sy * zx + py;
+            sx = t;
+        }
+
+        double t = dx * sx - dy * sy + x;
+        dy = dx * sy + dy * sx + y;
+        dx = t;
+
+        m++;
     }
 
-    void operator()( double result[], double zx[], double zy[], int maxIterations )
+    return 0.0;
+}
+
+class PerturbationParams
+{
+public:
+    PerturbationParams( const ReferenceOrbit* orbit ) :
+        m_orbit( orbit )
     {
-        calculateSSE2<N, VARIANT>( result, zx, zy, zx, zy, maxIterations );
     }
+
+protected:
+    const ReferenceOrbit* m_orbit;
 };
 
 template<int N, Variant VARIANT>
-class JuliaFunctorSSE2 : public FunctorSSE2, public JuliaFastParams
+class MandelbrotPerturbationFunctor : public Functor, public PerturbationParams
 {
 public:
-    JuliaFunctorSSE2( const JuliaFastParams& params ) : JuliaFastParams( params )
+    MandelbrotPerturbationFunctor( const PerturbationParams& params ) : PerturbationParams( params )
     {
     }
 
-    void operator()( double result[], double zx[], double zy[], int maxIterations )
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
     {
-        ALIGNXMM( double cx[ 2 ] ) = { m_cx, m_cx };
-        ALIGNXMM( double cy[ 2 ] ) = { m_cy, m_cy };
-        calculateSSE2<N, VARIANT>( result, zx, zy, cx, cy, maxIterations );
+        for ( int i = 0; i < count && !isCancelled( m_cancellation ); i++ ) {
+            double dx = zx[ i ];
+            double dy = zy[ i ];
+            int k = maxIterations;
+            int m = 1;
+            result[ i ] = calculatePerturbation<N, VARIANT>( dx, dy, zx[ i ], zy[ i ], m_orbit, maxIterations, k, m );
+        }
     }
-};
 
-FunctorSSE2* createMandelbrotFunctorSSE2( int exponent, Variant variant )
-{
-    return FastFunctorFactory<FunctorSSE2, MandelbrotFunctorSSE2>::create( exponent, variant, MandelbrotFastParams() );
-}
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
+    {
+        for ( int i = 0; i < count && !isCancelled( m_cancellation ); i++ ) {
+            if ( state.m_iterations[ i ] == 0 )
+                state.m_reference[ i ] = 1;
+            int k = resumeState( state, i, x[ i ], y[ i ], maxIterations );
+            result[ i ] = calculatePerturbation<N, VARIANT>( state.m_zx[ i ], state.m_zy[ i ], x[ i ], y[ i ], m_orbit, maxIterations, k, state.m_reference[ i ] );
+            state.m_iterations[ i ] = maxIterations - k;
+        }
+        return true;
+    }
+};
 
-FunctorSSE2* createJuliaFunctorSSE2( double cx, double cy, int exponent, Variant variant )
+Functor* createMandelbrotPerturbationFunctor( const ReferenceOrbit* orbit, int exponent, Variant variant )
 {
-    return FastFunctorFactory<FunctorSSE2, JuliaFunctorSSE2>::create( exponent, variant, JuliaFastParams( cx, cy ) );
+    return FastFunctorFactory<Functor, MandelbrotPerturbationFunctor>::create( exponent, variant, PerturbationParams( orbit ) );
 }
 
-void generatePreviewSSE2( const Input& input, const Output& output, FunctorSSE2* functor, int maxIterations )
+void interpolate( const Output& output )
 {
-    ALIGNXMM( double zx[ 2 ] );
-    ALIGNXMM( double zy[ 2 ] );
-
-    double result[ 2 ];
+    // points which are already calculated are not overwritten
+    const bool* known = output.m_known;
 
     for ( int y = 0; y < output.m_height; y += CellSize ) {
         double* row = output.m_buffer + output.m_stride * y;
-        for ( int x = 0; x < output.m_width; x += CellSize ) {
-            zx[ 0 ] = input.m_x + input.m_ca * x + input.m_sa * y;
-            zx[ 1 ] = zx[ 0 ] + input.m_ca * CellSize;
-            zy[ 0 ] = input.m_y - input.m_sa * x + input.m_ca * y;
-            zy[ 1 ] = zy[ 0 ] - input.m_sa * CellSize;
-            ( *functor )( result, zx, zy, maxIterations );
-            row[ x ] = result[ 0 ];
-            if ( x + CellSize < output.m_width )
-                row[ x + CellSize ] = result[ 1 ];
+        for ( int x = 0; x < output.m_width - CellSize; x += CellSize ) {
+            double p1 = row[ x ];
+            double p2 = row[ x + CellSize ];
+            for ( int i = 1; i < CellSize; i++ ) {
+                if ( !known || !known[ output.m_stride * y + x + i ] )
+                    row[ x + i ] = (double)( CellSize - i ) / (double)CellSize * p1 + (double)i / (double)CellSize * p2;
+            }
+        }
+    }
+    for ( int y = 0; y < output.m_height - CellSize; y += CellSize ) {
+        double* row = output.m_buffer + output.m_stride * y;
+        for ( int x = 0; x < output.m_width; x++ ) {
+            double p1 = row[ x ];
+            double p2 = row[ output.m_stride * CellSize + x ];
+            for ( int i = 1; i < CellSize; i++ ) {
+                if ( !known || !known[ output.m_stride * ( y + i ) + x ] )
+                    row[ output.m_stride * i + x ] = (double)( CellSize - i ) / (double)CellSize * p1 + (double)i / (double)CellSize * p2;
+            }
         }
     }
 }
 
-void generateDetailsSSE2( const Input& input, const Output& output, FunctorSSE2* functor, int maxIterations, double threshold )
+void markDetails( const Output& output, double threshold, bool* known )
 {
-    ALIGNXMM( double zx[ 2 ] );
-    ALIGNXMM( double zy[ 2 ] );
-
-    double result[ 2 ];
-
     for ( int y = 0; y < output.m_height; y += CellSize ) {
-        double* row = output.m_buffer + output.m_stride * y;
+        const double* row = output.m_buffer + output.m_stride * y;
+        bool* mark = known + output.m_stride * y;
+        for ( int x = 0; x < output.m_width; x += CellSize )
+            mark[ x ] = true;
         for ( int x = 0; x < output.m_width - CellSize; x += CellSize ) {
-            double p1 = row[ x ];
-            double p2 = row[ x + CellSize ];
-            if ( checkThreshold( p1, p2, threshold ) ) {
-                for ( int i = 1; i < CellSize; i += 2 ) {
-                    zx[ 0 ] = input.m_x + input.m_ca * ( x + i ) + input.m_sa * y;
-                    zx[ 1 ] = zx[ 0 ] + input.m_ca;
-                    zy[ 0 ] = input.m_y - input.m_sa * ( x + i ) + input.m_ca * y;
-                    zy[ 1 ] = zy[ 0 ] - input.m_sa;
-                    ( *functor )( result, zx, zy, maxIterations );
-                    row[ x + i ] = result[ 0 ];
-                    if ( i + 1 < CellSize )
-                        row[ x + i + 1 ] = result[ 1 ];
-                }
+            if ( checkThreshold( row[ x ], row[ x + CellSize ], threshold ) ) {
+                for ( int i = 1; i < CellSize; i++ )
+                    mark[ x + i ] = true;
             }
         }
     }
 
     for ( int y = 0; y < output.m_height - CellSize; y += CellSize ) {
-        double* row = output.m_buffer + output.m_stride * y;
+        const double* row = output.m_buffer + output.m_stride * y;
+        bool* mark = known + output.m_stride * y;
         for ( int x = 0; x < output.m_width; x += CellSize ) {
-            double p1 = row[ x ];
-            double p2 = row[ output.m_stride * CellSize + x ];
-            if ( checkThreshold( p1, p2, threshold ) ) {
-                for ( int i = 1; i < CellSize; i += 2 ) {
-                    zx[ 0 ] = input.m_x + input.m_ca * x + input.m_sa * ( y + i );
-                    zx[ 1 ] = zx[ 0 ] + input.m_sa;
-                    zy[ 0 ] = input.m_y - input.m_sa * x + input.m_ca * ( y + i );
-                    zy[ 1 ] = zy[ 0 ] + input.m_ca;
-                    ( *functor )( result, zx, zy, maxIterations );
-                    row[ output.m_stride * i + x ] = result[ 0 ];
-                    if ( i + 1 < CellSize )
-                        row[ output.m_stride * ( i + 1 ) + x ] = result[ 1 ];
-                }
+            if ( checkThreshold( row[ x ], row[ output.m_stride * CellSize + x ], threshold ) ) {
+                for ( int i = 1; i < CellSize; i++ )
+                    mark[ output.m_stride * i + x ] = true;
             }
         }
     }
 
     for ( int y = 0; y < output.m_height - CellSize; y += CellSize ) {
-        double* row = output.m_buffer + output.m_stride * y;
+        const double* row = output.m_buffer + output.m_stride * y;
+        bool* mark = known + output.m_stride * y;
         for ( int x = 0; x < output.m_width - CellSize; x += CellSize ) {
             double p1 = row[ x ];
             double p2 = row[ x + CellSize ];
@@ -893,22 +1281,544 @@ void generateDetailsSSE2( const Input& input, const Output& output, FunctorSSE2*
             double p4 = row[ output.m_stride * CellSize + x + CellSize ];
             if ( checkThreshold( p1, p2, p3, p4, threshold ) ) {
                 for ( int i = 1; i < CellSize; i++ ) {
-                    for ( int j = 1; j < CellSize; j += 2 ) {
-                        zx[ 0 ] = input.m_x + input.m_ca * ( x + j ) + input.m_sa * ( y + i );
-                        zx[ 1 ] = zx[ 0 ] + input.m_ca;
-                        zy[ 0 ] = input.m_y - input.m_sa * ( x + j ) + input.m_ca * ( y + i );
-                        zy[ 1 ] = zy[ 0 ] - input.m_sa;
-                        ( *functor )( result, zx, zy, maxIterations );
-                        row[ output.m_stride * i + x + j ] = result[ 0 ];
-                        if ( j + 1 < CellSize )
-                            row[ output.m_stride * i + x + j + 1 ] = result[ 1 ];
-                    }
+                    for ( int j = 1; j < CellSize; j++ )
+                        mark[ output.m_stride * i + x + j ] = true;
                 }
             }
         }
     }
 }
 
+static inline double estimateIterations( double value, int maxIterations )
+{
+    // the result is roughly the square root of the number of iterations;
+    // points which didn't escape are assumed to use all iterations
+    return ( value == 0.0 ) ? (double)maxIterations : value * value;
+}
+
+void estimateDetails( const Output& output, double threshold, int maxIterations, double* cost )
+{
+    int columns = ( output.m_width - 1 ) / CellSize;
+    for ( int i = 0; i < columns; i++ )
+        cost[ i ] = 0.0;
+
+    for ( int y = 0; y < output.m_height - CellSize; y += CellSize ) {
+        const double* row = output.m_buffer + output.m_stride * y;
+        for ( int i = 0; i < columns; i++ ) {
+            int x = i * CellSize;
+            double p1 = row[ x ];
+            double p2 = row[ x + CellSize ];
+            double p3 = row[ output.m_stride * CellSize + x ];
+            double p4 = row[ output.m_stride * CellSize + x + CellSize ];
+
+            // the points of a cell without details are only checked
+            double iterations = 1.0;
+            if ( checkThreshold( p1, p2, p3, p4, threshold ) ) {
+                iterations += 0.25 * ( estimateIterations( p1, maxIterations ) + estimateIterations( p2, maxIterations )
+                    + estimateIterations( p3, maxIterations ) + estimateIterations( p4, maxIterations ) );
+            }
+
+            cost[ i ] += iterations * ( CellSize * CellSize - 1 );
+        }
+    }
+}
+
+#if defined( HAVE_SSE2 )
+
+enum CPUFeatures
+{
+    MMX = 1,
+    SSE = 2,
+    SSE2 = 4,
+    AVX2 = 8,
+    FMA = 16
+};
+
+// based on qdrawhelper.cpp
+static int detectCPUFeatures()
+{
+#if defined( __x86_64__ ) || defined( __ia64__ ) || defined( Q_OS_WIN64 )
+    return MMX | SSE | SSE2;
+#elif defined( __i386__ ) || defined( _M_IX86 )
+    int result = 0;
+#if defined( Q_CC_GNU )
+    asm( "push %%ebx\n"
+         "pushf\n"
+         "pop %%eax\n"
+         "mov %%eax, %%ebx\n"
+         "xor $0x00200000, %%eax\n"
+         "push %%eax\n"
+         "popf\n"
+         "pushf\n"
+         "pop %%eax\n"
+         "xor %%edx, %%edx\n"
+         "xor %%ebx, %%eax\n"
+         "jz 1f\n"
+         "mov $0x00000001, %%eax\n"
+         "cpuid\n"
+         "1:\n"
+         "pop %%ebx\n"
+         "mov %%edx, %0\n"
+        : "=r" ( result )
+        :
+        : "%eax", "%ecx", "%edx"
+        );
+#elif defined ( Q_OS_WIN )
+    _asm {
+        push eax
+        push ebx
+        push ecx
+        push edx
+        pushfd
+        pop eax
+        mov ebx, eax
+        xor eax, 00200000h
+        push eax
+        popfd
+        pushfd
+        pop eax
+        mov edx, 0
+        xor eax, ebx
+        jz skip
+        mov eax, 1
+        cpuid
+        mov result, edx
+    skip:
+        pop edx
+        pop ecx
+        pop ebx
+        pop eax
+    }
+#endif
+    int features = 0;
+    if ( result & ( 1 << 23 ) )
+        features |= MMX;
+    if ( result & ( 1 << 25 ) )
+        features |= SSE;
+    if ( result & ( 1 << 26 ) )
+        features |= SSE2;
+    return features;
+#else
+    return 0;
+#endif
+}
+
+#if defined( HAVE_AVX2 )
+
+// AVX2 also requires the operating system to save the YMM registers
+static int detectAVX2Features()
+{
+    unsigned int regs[ 4 ] = { 0, 0, 0, 0 };
+#if defined( Q_CC_MSVC )
+    int info[ 4 ];
+    __cpuid( info, 0 );
+    if ( info[ 0 ] < 7 )
+        return 0;
+    __cpuid( info, 1 );
+    regs[ 2 ] = info[ 2 ];
+#else
+    if ( __get_cpuid_max( 0, NULL ) < 7 )
+        return 0;
+    __get_cpuid( 1, &regs[ 0 ], &regs[ 1 ], &regs[ 2 ], &regs[ 3 ] );
+#endif
+
+    // OSXSAVE and AVX
+    if ( ( regs[ 2 ] & ( ( 1 << 27 ) | ( 1 << 28 ) ) ) != ( ( 1 << 27 ) | ( 1 << 28 ) ) )
+        return 0;
+
+    unsigned int xcr0;
+#if defined( Q_CC_MSVC )
+    xcr0 = (unsigned int)_xgetbv( 0 );
+#else
+    unsigned int xcr0high;
+    asm( ".byte 0x0f, 0x01, 0xd0" : "=a" ( xcr0 ), "=d" ( xcr0high ) : "c" ( 0 ) );
+#endif
+
+    // XMM and YMM state
+    if ( ( xcr0 & 6 ) != 6 )
+        return 0;
+
+    int features = 0;
+    if ( regs[ 2 ] & ( 1 << 12 ) )
+        features |= FMA;
+
+#if defined( Q_CC_MSVC )
+    __cpuidex( info, 7, 0 );
+    regs[ 1 ] = info[ 1 ];
+#else
+    __cpuid_count( 7, 0, regs[ 0 ], regs[ 1 ], regs[ 2 ], regs[ 3 ] );
+#endif
+
+    if ( regs[ 1 ] & ( 1 << 5 ) )
+        features |= AVX2;
+
+    return features;
+}
+
+#endif // defined( HAVE_AVX2 )
+
+static const int AvailableCPUFeatures = detectCPUFeatures()
+#if defined( HAVE_AVX2 )
+    | detectAVX2Features()
+#endif
+    ;
+
+bool isSSE2Available()
+{
+    return AvailableCPUFeatures & SSE2;
+}
+
+#if defined( HAVE_AVX2 )
+
+bool isAVX2Available()
+{
+    return ( AvailableCPUFeatures & ( SSE2 | AVX2 | FMA ) ) == ( SSE2 | AVX2 | FMA );
+}
+
+#endif
+
+// wraps the SSE2 intrinsics for calculateFastVector and the functions in vectormath_p.h
+class VectorSSE2
+{
+public:
+    typedef __m128d Type;
+    typedef double Real;
+
+    static const int Lanes = 2;
+
+    static Type set( double a ) { return _mm_set1_pd( a ); }
+    static Type setZero() { return _mm_setzero_pd(); }
+
+    static Type load( const double* p ) { return _mm_load_pd( p ); }
+    static void store( double* p, Type a ) { _mm_store_pd( p, a ); }
+
+    static Type add( Type a, Type b ) { return _mm_add_pd( a, b ); }
+    static Type sub( Type a, Type b ) { return _mm_sub_pd( a, b ); }
+    static Type mul( Type a, Type b ) { return _mm_mul_pd( a, b ); }
+    static Type div( Type a, Type b ) { return _mm_div_pd( a, b ); }
+    static Type mulAdd( Type a, Type b, Type c ) { return _mm_add_pd( _mm_mul_pd( a, b ), c ); }
+    static Type mulSub( Type a, Type b, Type c ) { return _mm_sub_pd( _mm_mul_pd( a, b ), c ); }
+    static Type minimum( Type a, Type b ) { return _mm_min_pd( a, b ); }
+    static Type maximum( Type a, Type b ) { return _mm_max_pd( a, b ); }
+
+    static Type bitAnd( Type a, Type b ) { return _mm_and_pd( a, b ); }
+    static Type bitAndNot( Type a, Type b ) { return _mm_andnot_pd( a, b ); }
+    static Type bitOr( Type a, Type b ) { return _mm_or_pd( a, b ); }
+    static Type bitXor( Type a, Type b ) { return _mm_xor_pd( a, b ); }
+
+    static Type less( Type a, Type b ) { return _mm_cmplt_pd( a, b ); }
+    static Type greater( Type a, Type b ) { return _mm_cmpgt_pd( a, b ); }
+    static Type greaterEqual( Type a, Type b ) { return _mm_cmpge_pd( a, b ); }
+    static Type select( Type mask, Type a, Type b ) { return _mm_or_pd( _mm_and_pd( mask, a ), _mm_andnot_pd( mask, b ) ); }
+    static int moveMask( Type a ) { return _mm_movemask_pd( a ); }
+
+    static Type mantissa( Type x )
+    {
+        __m128i bits = _mm_and_si128( _mm_castpd_si128( x ), _mm_set_epi32( 0x000fffff, int( 0xffffffff ), 0x000fffff, int( 0xffffffff ) ) );
+        return _mm_castsi128_pd( _mm_or_si128( bits, _mm_set_epi32( 0x3ff00000, 0, 0x3ff00000, 0 ) ) );
+    }
+
+    static Type exponent( Type x )
+    {
+        // store the biased exponent in the mantissa of 2^52
+        __m128i bits = _mm_or_si128( _mm_srli_epi64( _mm_castpd_si128( x ), 52 ), _mm_set_epi32( 0x43300000, 0, 0x43300000, 0 ) );
+        return _mm_sub_pd( _mm_castsi128_pd( bits ), _mm_set1_pd( 4503599627370496.0 + 1023.0 ) );
+    }
+
+    static Type pow2( Type n )
+    {
+        __m128i bits = _mm_castpd_si128( _mm_add_pd( n, _mm_set1_pd( 4503599627370496.0 + 1023.0 ) ) );
+        return _mm_castsi128_pd( _mm_slli_epi64( bits, 52 ) );
+    }
+
+    static Type round( Type x )
+    {
+        Type magic = _mm_set1_pd( 6755399441055744.0 );
+        return _mm_sub_pd( _mm_add_pd( x, magic ), magic );
+    }
+
+    static Type bit( Type n, int b )
+    {
+        __m128i bits = _mm_castpd_si128( _mm_add_pd( n, _mm_set1_pd( 4503599627370496.0 ) ) );
+        bits = _mm_and_si128( _mm_srli_epi64( bits, b ), _mm_set_epi32( 0, 1, 0, 1 ) );
+        return _mm_castsi128_pd( _mm_sub_epi64( _mm_setzero_si128(), bits ) );
+    }
+
+    static Type productError( Type a, Type b, Type p )
+    {
+#if defined( __FMA__ )
+        return _mm_fmsub_pd( a, b, p );
+#else
+        // Dekker's algorithm, see the scalar version
+        Type splitter = _mm_set1_pd( 134217729.0 );
+        Type t = _mm_mul_pd( splitter, a );
+        Type ah = _mm_sub_pd( t, _mm_sub_pd( t, a ) );
+        Type al = _mm_sub_pd( a, ah );
+        t = _mm_mul_pd( splitter, b );
+        Type bh = _mm_sub_pd( t, _mm_sub_pd( t, b ) );
+        Type bl = _mm_sub_pd( b, bh );
+        Type e = _mm_sub_pd( _mm_mul_pd( ah, bh ), p );
+        e = _mm_add_pd( _mm_add_pd( _mm_add_pd( e, _mm_mul_pd( ah, bl ) ), _mm_mul_pd( al, bh ) ), _mm_mul_pd( al, bl ) );
+        return e;
+#endif
+    }
+};
+
+template<int N, Variant VARIANT>
+class MandelbrotFunctorSSE2 : public FunctorSSE2, public MandelbrotFastParams
+{
+public:
+    MandelbrotFunctorSSE2( const MandelbrotFastParams& params ) : MandelbrotFastParams( params )
+    {
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        calculateFastVector<VectorSSE2, N, VARIANT, false>( result, zx, zy, count, 0.0, 0.0, m_tolerance, maxIterations, m_cancellation );
+    }
+
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
+    {
+        calculateFastVector<VectorSSE2, N, VARIANT, false>( result, x, y, count, 0.0, 0.0, m_tolerance, maxIterations, m_cancellation, &state );
+        return true;
+    }
+};
+
+template<int N, Variant VARIANT>
+class JuliaFunctorSSE2 : public FunctorSSE2, public JuliaFastParams
+{
+public:
+    JuliaFunctorSSE2( const JuliaFastParams& params ) : JuliaFastParams( params )
+    {
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        calculateFastVector<VectorSSE2, N, VARIANT, true>( result, zx, zy, count, m_cx, m_cy, m_tolerance, maxIterations, m_cancellation );
+    }
+
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
+    {
+        calculateFastVector<VectorSSE2, N, VARIANT, true>( result, x, y, count, m_cx, m_cy, m_tolerance, maxIterations, m_cancellation, &state );
+        return true;
+    }
+};
+
+FunctorSSE2* createMandelbrotFunctorSSE2( int exponent, Variant variant, double tolerance )
+{
+    return FastFunctorFactory<FunctorSSE2, MandelbrotFunctorSSE2>::create( exponent, variant, MandelbrotFastParams( tolerance ) );
+}
+
+FunctorSSE2* createJuliaFunctorSSE2( double cx, double cy, int exponent, Variant variant, double tolerance )
+{
+    return FastFunctorFactory<FunctorSSE2, JuliaFunctorSSE2>::create( exponent, variant, JuliaFastParams( cx, cy, tolerance ) );
+}
+
+// single precision operations for calculateFastVector
+class VectorFloatSSE2
+{
+public:
+    typedef __m128 Type;
+    typedef float Real;
+
+    static const int Lanes = 4;
+
+    static Type set( double a ) { return _mm_set1_ps( (float)a ); }
+    static Type setZero() { return _mm_setzero_ps(); }
+
+    static Type load( const float* p ) { return _mm_load_ps( p ); }
+    static void store( float* p, Type a ) { _mm_store_ps( p, a ); }
+
+    static Type add( Type a, Type b ) { return _mm_add_ps( a, b ); }
+    static Type sub( Type a, Type b ) { return _mm_sub_ps( a, b ); }
+    static Type mul( Type a, Type b ) { return _mm_mul_ps( a, b ); }
+    static Type mulAdd( Type a, Type b, Type c ) { return _mm_add_ps( _mm_mul_ps( a, b ), c ); }
+    static Type mulSub( Type a, Type b, Type c ) { return _mm_sub_ps( _mm_mul_ps( a, b ), c ); }
+
+    static Type bitAndNot( Type a, Type b ) { return _mm_andnot_ps( a, b ); }
+    static Type bitXor( Type a, Type b ) { return _mm_xor_ps( a, b ); }
+
+    static Type greaterEqual( Type a, Type b ) { return _mm_cmpge_ps( a, b ); }
+    static int moveMask( Type a ) { return _mm_movemask_ps( a ); }
+};
+
+template<int N, Variant VARIANT>
+class MandelbrotFloatFunctorSSE2 : public FunctorSSE2, public MandelbrotFastParams
+{
+public:
+    MandelbrotFloatFunctorSSE2( const MandelbrotFastParams& params ) : MandelbrotFastParams( params )
+    {
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        calculateFastVector<VectorFloatSSE2, N, VARIANT, false>( result, zx, zy, count, 0.0, 0.0, m_tolerance, maxIterations, m_cancellation );
+    }
+
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
+    {
+        calculateFastVector<VectorFloatSSE2, N, VARIANT, false>( result, x, y, count, 0.0, 0.0, m_tolerance, maxIterations, m_cancellation, &state );
+        return true;
+    }
+};
+
+template<int N, Variant VARIANT>
+class JuliaFloatFunctorSSE2 : public FunctorSSE2, public JuliaFastParams
+{
+public:
+    JuliaFloatFunctorSSE2( const JuliaFastParams& params ) : JuliaFastParams( params )
+    {
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        calculateFastVector<VectorFloatSSE2, N, VARIANT, true>( result, zx, zy, count, m_cx, m_cy, m_tolerance, maxIterations, m_cancellation );
+    }
+
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
+    {
+        calculateFastVector<VectorFloatSSE2, N, VARIANT, true>( result, x, y, count, m_cx, m_cy, m_tolerance, maxIterations, m_cancellation, &state );
+        return true;
+    }
+};
+
+FunctorSSE2* createMandelbrotFloatFunctorSSE2( int exponent, Variant variant, double tolerance )
+{
+    return FastFunctorFactory<FunctorSSE2, MandelbrotFloatFunctorSSE2>::create( exponent, variant, MandelbrotFastParams( tolerance ) );
+}
+
+FunctorSSE2* createJuliaFloatFunctorSSE2( double cx, double cy, int exponent, Variant variant, double tolerance )
+{
+    return FastFunctorFactory<FunctorSSE2, JuliaFloatFunctorSSE2>::create( exponent, variant, JuliaFastParams( cx, cy, tolerance ) );
+}
+
+template<Variant VARIANT>
+class MandelbrotRealFunctorSSE2 : public FunctorSSE2, public MandelbrotParams
+{
+public:
+    MandelbrotRealFunctorSSE2( const MandelbrotParams& params ) : MandelbrotParams( params )
+    {
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        calculateRealVector<VectorSSE2, VARIANT, false>( result, zx, zy, count, 0.0, 0.0, m_exponent, maxIterations, m_cancellation );
+    }
+
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
+    {
+        calculateRealVector<VectorSSE2, VARIANT, false>( result, x, y, count, 0.0, 0.0, m_exponent, maxIterations, m_cancellation, &state );
+        return true;
+    }
+};
+
+template<Variant VARIANT>
+class JuliaRealFunctorSSE2 : public FunctorSSE2, public JuliaParams
+{
+public:
+    JuliaRealFunctorSSE2( const JuliaParams& params ) : JuliaParams( params )
+    {
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        calculateRealVector<VectorSSE2, VARIANT, true>( result, zx, zy, count, m_cx, m_cy, m_exponent, maxIterations, m_cancellation );
+    }
+
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
+    {
+        calculateRealVector<VectorSSE2, VARIANT, true>( result, x, y, count, m_cx, m_cy, m_exponent, maxIterations, m_cancellation, &state );
+        return true;
+    }
+};
+
+FunctorSSE2* createMandelbrotRealFunctorSSE2( double exponent, Variant variant )
+{
+    return FunctorFactory<FunctorSSE2, MandelbrotRealFunctorSSE2>::create( variant, MandelbrotParams( exponent ) );
+}
+
+FunctorSSE2* createJuliaRealFunctorSSE2( double cx, double cy, double exponent, Variant variant )
+{
+    return FunctorFactory<FunctorSSE2, JuliaRealFunctorSSE2>::create( variant, JuliaParams( cx, cy, exponent ) );
+}
+
+template<int N, Variant VARIANT>
+class MandelbrotDoubleDoubleFunctorSSE2 : public FunctorSSE2, public DoubleDoubleParams
+{
+public:
+    MandelbrotDoubleDoubleFunctorSSE2( const DoubleDoubleParams& params ) : DoubleDoubleParams( params )
+    {
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        calculateDoubleDoubleVector<VectorSSE2, N, VARIANT, false>( result, zx, zy, count, m_x, m_y, 0.0, 0.0, maxIterations, m_cancellation );
+    }
+};
+
+template<int N, Variant VARIANT>
+class JuliaDoubleDoubleFunctorSSE2 : public FunctorSSE2, public JuliaDoubleDoubleParams
+{
+public:
+    JuliaDoubleDoubleFunctorSSE2( const JuliaDoubleDoubleParams& params ) : JuliaDoubleDoubleParams( params )
+    {
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        calculateDoubleDoubleVector<VectorSSE2, N, VARIANT, true>( result, zx, zy, count, m_x, m_y, m_cx, m_cy, maxIterations, m_cancellation );
+    }
+};
+
+FunctorSSE2* createMandelbrotDoubleDoubleFunctorSSE2( const FixedPoint& x, const FixedPoint& y, int exponent, Variant variant )
+{
+    return FastFunctorFactory<FunctorSSE2, MandelbrotDoubleDoubleFunctorSSE2>::create( exponent, variant, DoubleDoubleParams( x, y ) );
+}
+
+FunctorSSE2* createJuliaDoubleDoubleFunctorSSE2( const FixedPoint& x, const FixedPoint& y, double cx, double cy, int exponent, Variant variant )
+{
+    return FastFunctorFactory<FunctorSSE2, JuliaDoubleDoubleFunctorSSE2>::create( exponent, variant, JuliaDoubleDoubleParams( x, y, cx, cy ) );
+}
+
+void generatePreviewSSE2( const Input& input, const Output& output, FunctorSSE2* functor, int maxIterations )
+{
+    PointQueue queue( output );
+    queuePreview( input, output, &queue );
+    queue.calculate( functor, maxIterations );
+}
+
+void generateDetailsSSE2( const Input& input, const Output& output, FunctorSSE2* functor, int maxIterations, double threshold )
+{
+    // the preview is incomplete, so the details are not worth queuing
+    if ( isCancelled( functor->cancellation() ) )
+        return;
+
+    PointQueue queue( output );
+    queueDetails( input, output, threshold, &queue );
+    queue.calculate( functor, maxIterations );
+}
+
+void generateRectanglesSSE2( const Input& input, const Output& output, FunctorSSE2* functor, int maxIterations, double threshold, bool verify )
+{
+    PointQueue queue( output );
+    RectangleSubdivision subdivision( input, output, threshold, verify );
+    while ( !isCancelled( functor->cancellation() ) && subdivision.queuePoints( &queue ) )
+        queue.calculate( functor, maxIterations );
+}
+
+void generateQuadtreeSSE2( const Input& input, const Output& output, FunctorSSE2* functor, int maxIterations, double threshold )
+{
+    PointQueue queue( output );
+    QuadtreeRefinement refinement( input, output, threshold );
+    while ( !isCancelled( functor->cancellation() ) && refinement.queuePoints( &queue ) )
+        queue.calculate( functor, maxIterations );
+}
+
+void resumePointsSSE2( const Input& input, const Output& output, FunctorSSE2* functor, int maxIterations, Continuation* continuation )
+{
+    resumeContinuation( input, output, functor, maxIterations, continuation );
+}
+
 #endif // defined( HAVE_SSE2 )
 
 } // namespace GeneratorCore
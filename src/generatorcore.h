@@ -23,6 +23,12 @@
 #undef HAVE_SSE2
 #endif
 
+#if !defined( HAVE_SSE2 )
+#undef HAVE_AVX2
+#endif
+
+#include "fixedpoint.h"
+
 namespace GeneratorCore
 {
 
@@ -36,22 +42,101 @@ enum Variant
     AbsoluteImVariant
 };
 
+// the state of a stream of points which can be iterated further; the reference
+// is the index of the point of the reference orbit used by the perturbation
+struct IterationState
+{
+    double* m_zx;
+    double* m_zy;
+    int* m_iterations;
+    int* m_reference;
+};
+
+// a flag which is set from another thread to abort a calculation; the functors
+// stop loading new points and the sampling methods stop refining the output,
+// which remains incomplete
+class Cancellation
+{
+public:
+    Cancellation() : m_cancelled( false ) { }
+
+public:
+    void cancel() { m_cancelled = true; }
+    void reset() { m_cancelled = false; }
+
+    bool isCancelled() const { return m_cancelled; }
+
+private:
+    volatile bool m_cancelled;
+};
+
 class Functor
 {
 public:
+    Functor() : m_cancellation( NULL ) { }
     virtual ~Functor() {}
 
-    virtual double operator()( double zx, double zy, int maxIterations ) = 0;
+    // the functor may be shared by threads which are cancelled together
+    void setCancellation( const Cancellation* cancellation ) { m_cancellation = cancellation; }
+    const Cancellation* cancellation() const { return m_cancellation; }
+
+    // calculates a stream of points given as separate arrays of coordinates
+    virtual void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations ) = 0;
+
+    // continues iterating the points from the given state, which is updated
+    // for the points which don't escape; points with zero iterations are
+    // started from the beginning; a point stopped before the maximum number
+    // of iterations was found to be periodic; returns false if not supported
+    virtual bool resume( double /*result*/[], const double /*x*/[], const double /*y*/[], const IterationState& /*state*/, int /*count*/, int /*maxIterations*/ ) { return false; }
+
+protected:
+    const Cancellation* m_cancellation;
 };
 
 Functor* createMandelbrotFunctor( double exponent, Variant variant );
 Functor* createJuliaFunctor( double cx, double cy, double exponent, Variant variant );
 
-Functor* createMandelbrotFastFunctor( int exponent, Variant variant );
-Functor* createJuliaFastFunctor( double cx, double cy, int exponent, Variant variant );
+// the functors for integral exponents stop iterating when the orbit returns
+// within the tolerance of an earlier point, assuming that it's periodic; the
+// tolerance should be a small fraction of the distance between pixels
+Functor* createMandelbrotFastFunctor( int exponent, Variant variant, double tolerance );
+Functor* createJuliaFastFunctor( double cx, double cy, int exponent, Variant variant, double tolerance );
+
+// the double-double functors extend the precision beyond the limit of double;
+// their coordinates are relative to the given center of the view
+Functor* createMandelbrotDoubleDoubleFunctor( const FixedPoint& x, const FixedPoint& y, int exponent, Variant variant );
+Functor* createJuliaDoubleDoubleFunctor( const FixedPoint& x, const FixedPoint& y, double cx, double cy, int exponent, Variant variant );
 
 static const int CellSize = 3;
 
+// the state of the points of an output which didn't escape, so that they can
+// be iterated further when the maximum number of iterations is increased; the
+// index of a point is its offset in the buffer of the output
+class Continuation
+{
+public:
+    Continuation();
+    ~Continuation();
+
+public:
+    void append( int index, double zx, double zy, int iterations, int reference );
+
+    int count() const { return m_count; }
+    const int* indexes() const { return m_indexes; }
+
+    IterationState state() const;
+
+private:
+    int* m_indexes;
+    double* m_zx;
+    double* m_zy;
+    int* m_iterations;
+    int* m_reference;
+
+    int m_count;
+    int m_capacity;
+};
+
 struct Input
 {
     double m_x;
@@ -66,6 +151,8 @@ struct Output
     int m_stride;
     int m_width;  // M * CellSize + 1
     int m_height; // N * CellSize + 1
+    const bool* m_known; // points which are already calculated, using the same stride; may be NULL
+    Continuation* m_continuation; // collects the state of points which didn't escape; may be NULL
 };
 
 void generatePreview( const Input& input, const Output& output, Functor* functor, int maxIterations );
@@ -73,6 +160,62 @@ void generateDetails( const Input& input, const Output& output, Functor* functor
 
 void interpolate( const Output& output );
 
+// marks the points of the preview grid and the details which generateDetails()
+// calculates with the given threshold; known has the stride of the output
+void markDetails( const Output& output, double threshold, bool* known );
+
+// estimates the number of iterations which generateDetails() needs for each
+// column of cells from the preview grid; cost has ( m_width - 1 ) / CellSize
+// elements
+void estimateDetails( const Output& output, double threshold, int maxIterations, double* cost );
+
+// continues iterating the points of the continuation and stores the results
+// in the output; the points which still don't escape are added to the
+// continuation of the output
+void resumePoints( const Input& input, const Output& output, Functor* functor, int maxIterations, Continuation* continuation );
+
+// calculates the whole output by subdividing it into rectangles and filling
+// those whose perimeter is uniform (the Mariani-Silver algorithm); when verify
+// is set, the middle row and column of each rectangle are checked before it's
+// filled; the output doesn't have to be aligned to CellSize
+void generateRectangles( const Input& input, const Output& output, Functor* functor, int maxIterations, double threshold, bool verify );
+
+// calculates the corners of cells of QuadtreeCellSize pixels and splits those
+// whose corners differ by more than the threshold, down to single pixels; the
+// remaining cells are interpolated; the output doesn't have to be aligned
+static const int QuadtreeCellSize = 16;
+
+void generateQuadtree( const Input& input, const Output& output, Functor* functor, int maxIterations, double threshold );
+
+// the orbit of the center of the view calculated with the precision of its
+// coordinates; the points are stored as pairs of doubles, starting from zero
+class ReferenceOrbit
+{
+public:
+    ReferenceOrbit();
+    ~ReferenceOrbit();
+
+public:
+    void append( double x, double y );
+
+    int length() const { return m_length; }
+    const double* points() const { return m_points; }
+
+private:
+    double* m_points;
+    int m_length;
+    int m_capacity;
+};
+
+// returns NULL when the calculation is cancelled
+ReferenceOrbit* createMandelbrotOrbit( const FixedPoint& cx, const FixedPoint& cy, int exponent, Variant variant, int maxIterations,
+    const Cancellation* cancellation = NULL );
+
+// the functor calculates the difference between the point and the reference,
+// so its coordinates must be relative to the center of the view; the orbit
+// is not owned by the functor
+Functor* createMandelbrotPerturbationFunctor( const ReferenceOrbit* orbit, int exponent, Variant variant );
+
 #if defined( HAVE_SSE2 )
 
 bool isSSE2Available();
@@ -80,19 +223,91 @@ bool isSSE2Available();
 class FunctorSSE2
 {
 public:
+    FunctorSSE2() : m_cancellation( NULL ) { }
     virtual ~FunctorSSE2() {}
 
-    virtual void operator()( double result[], double zx[], double zy[], int maxIterations ) = 0;
+    // see Functor::setCancellation()
+    void setCancellation( const Cancellation* cancellation ) { m_cancellation = cancellation; }
+    const Cancellation* cancellation() const { return m_cancellation; }
+
+    virtual void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations ) = 0;
+
+    // see Functor::resume()
+    virtual bool resume( double /*result*/[], const double /*x*/[], const double /*y*/[], const IterationState& /*state*/, int /*count*/, int /*maxIterations*/ ) { return false; }
+
+protected:
+    const Cancellation* m_cancellation;
 };
 
-FunctorSSE2* createMandelbrotFunctorSSE2( int exponent, Variant variant );
-FunctorSSE2* createJuliaFunctorSSE2( double cx, double cy, int exponent, Variant variant ); 
+FunctorSSE2* createMandelbrotFunctorSSE2( int exponent, Variant variant, double tolerance );
+FunctorSSE2* createJuliaFunctorSSE2( double cx, double cy, int exponent, Variant variant, double tolerance ); 
+
+// the single precision functors are suitable for small zoom factors
+FunctorSSE2* createMandelbrotFloatFunctorSSE2( int exponent, Variant variant, double tolerance );
+FunctorSSE2* createJuliaFloatFunctorSSE2( double cx, double cy, int exponent, Variant variant, double tolerance );
+
+FunctorSSE2* createMandelbrotRealFunctorSSE2( double exponent, Variant variant );
+FunctorSSE2* createJuliaRealFunctorSSE2( double cx, double cy, double exponent, Variant variant );
+
+FunctorSSE2* createMandelbrotDoubleDoubleFunctorSSE2( const FixedPoint& x, const FixedPoint& y, int exponent, Variant variant );
+FunctorSSE2* createJuliaDoubleDoubleFunctorSSE2( const FixedPoint& x, const FixedPoint& y, double cx, double cy, int exponent, Variant variant );
 
 void generatePreviewSSE2( const Input& input, const Output& output, FunctorSSE2* functor, int maxIterations );
 void generateDetailsSSE2( const Input& input, const Output& output, FunctorSSE2* functor, int maxIterations, double threshold );
 
+void generateRectanglesSSE2( const Input& input, const Output& output, FunctorSSE2* functor, int maxIterations, double threshold, bool verify );
+void generateQuadtreeSSE2( const Input& input, const Output& output, FunctorSSE2* functor, int maxIterations, double threshold );
+
+void resumePointsSSE2( const Input& input, const Output& output, FunctorSSE2* functor, int maxIterations, Continuation* continuation );
+
 #endif // defined( HAVE_SSE2 )
 
+#if defined( HAVE_AVX2 )
+
+bool isAVX2Available();
+
+class FunctorAVX2
+{
+public:
+    FunctorAVX2() : m_cancellation( NULL ) { }
+    virtual ~FunctorAVX2() {}
+
+    // see Functor::setCancellation()
+    void setCancellation( const Cancellation* cancellation ) { m_cancellation = cancellation; }
+    const Cancellation* cancellation() const { return m_cancellation; }
+
+    virtual void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations ) = 0;
+
+    // see Functor::resume()
+    virtual bool resume( double /*result*/[], const double /*x*/[], const double /*y*/[], const IterationState& /*state*/, int /*count*/, int /*maxIterations*/ ) { return false; }
+
+protected:
+    const Cancellation* m_cancellation;
+};
+
+FunctorAVX2* createMandelbrotFunctorAVX2( int exponent, Variant variant, double tolerance );
+FunctorAVX2* createJuliaFunctorAVX2( double cx, double cy, int exponent, Variant variant, double tolerance );
+
+// the single precision functors are suitable for small zoom factors
+FunctorAVX2* createMandelbrotFloatFunctorAVX2( int exponent, Variant variant, double tolerance );
+FunctorAVX2* createJuliaFloatFunctorAVX2( double cx, double cy, int exponent, Variant variant, double tolerance );
+
+FunctorAVX2* createMandelbrotRealFunctorAVX2( double exponent, Variant variant );
+FunctorAVX2* createJuliaRealFunctorAVX2( double cx, double cy, double exponent, Variant variant );
+
+FunctorAVX2* createMandelbrotDoubleDoubleFunctorAVX2( const FixedPoint& x, const FixedPoint& y, int exponent, Variant variant );
+FunctorAVX2* createJuliaDoubleDoubleFunctorAVX2( const FixedPoint& x, const FixedPoint& y, double cx, double cy, int exponent, Variant variant );
+
+void generatePreviewAVX2( const Input& input, const Output& output, FunctorAVX2* functor, int maxIterations );
+void generateDetailsAVX2( const Input& input, const Output& output, FunctorAVX2* functor, int maxIterations, double threshold );
+
+void generateRectanglesAVX2( const Input& input, const Output& output, FunctorAVX2* functor, int maxIterations, double threshold, bool verify );
+void generateQuadtreeAVX2( const Input& input, const Output& output, FunctorAVX2* functor, int maxIterations, double threshold );
+
+void resumePointsAVX2( const Input& input, const Output& output, FunctorAVX2* functor, int maxIterations, Continuation* continuation );
+
+#endif // defined( HAVE_AVX2 )
+
 } // namespace GeneratorCore
 
 #endif
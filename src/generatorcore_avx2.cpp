@@ -0,0 +1,357 @@
+/**************************************************************************
+* This file is part of the Fraqtive program
+* Copyright (C) 2004-2012 Michał Męciński
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include "generatorcore_p.h"
+
+#if defined( HAVE_AVX2 )
+
+#include <immintrin.h>
+
+// this file must be compiled with AVX2 and FMA enabled; the functions are only
+// called when isAVX2Available() returns true
+
+namespace GeneratorCore
+{
+
+// wraps the AVX2 intrinsics for calculateFastVector and the functions in vectormath_p.h
+class VectorAVX2
+{
+public:
+    typedef __m256d Type;
+    typedef double Real;
+
+    static const int Lanes = 4;
+
+    static Type set( double a ) { return _mm256_set1_pd( a ); }
+    static Type setZero() { return _mm256_setzero_pd(); }
+
+    static Type load( const double* p ) { return _mm256_load_pd( p ); }
+    static void store( double* p, Type a ) { _mm256_store_pd( p, a ); }
+
+    static Type add( Type a, Type b ) { return _mm256_add_pd( a, b ); }
+    static Type sub( Type a, Type b ) { return _mm256_sub_pd( a, b ); }
+    static Type mul( Type a, Type b ) { return _mm256_mul_pd( a, b ); }
+    static Type div( Type a, Type b ) { return _mm256_div_pd( a, b ); }
+    static Type mulAdd( Type a, Type b, Type c ) { return _mm256_fmadd_pd( a, b, c ); }
+    static Type mulSub( Type a, Type b, Type c ) { return _mm256_fmsub_pd( a, b, c ); }
+    static Type minimum( Type a, Type b ) { return _mm256_min_pd( a, b ); }
+    static Type maximum( Type a, Type b ) { return _mm256_max_pd( a, b ); }
+
+    static Type bitAnd( Type a, Type b ) { return _mm256_and_pd( a, b ); }
+    static Type bitAndNot( Type a, Type b ) { return _mm256_andnot_pd( a, b ); }
+    static Type bitOr( Type a, Type b ) { return _mm256_or_pd( a, b ); }
+    static Type bitXor( Type a, Type b ) { return _mm256_xor_pd( a, b ); }
+
+    static Type less( Type a, Type b ) { return _mm256_cmp_pd( a, b, _CMP_LT_OQ ); }
+    static Type greater( Type a, Type b ) { return _mm256_cmp_pd( a, b, _CMP_GT_OQ ); }
+    static Type greaterEqual( Type a, Type b ) { return _mm256_cmp_pd( a, b, _CMP_GE_OQ ); }
+    static Type select( Type mask, Type a, Type b ) { return _mm256_blendv_pd( b, a, mask ); }
+    static int moveMask( Type a ) { return _mm256_movemask_pd( a ); }
+
+    static Type mantissa( Type x )
+    {
+        __m256i bits = _mm256_and_si256( _mm256_castpd_si256( x ), _mm256_set1_epi64x( 0x000fffffffffffffLL ) );
+        return _mm256_castsi256_pd( _mm256_or_si256( bits, _mm256_set1_epi64x( 0x3ff0000000000000LL ) ) );
+    }
+
+    static Type exponent( Type x )
+    {
+        // store the biased exponent in the mantissa of 2^52
+        __m256i bits = _mm256_or_si256( _mm256_srli_epi64( _mm256_castpd_si256( x ), 52 ), _mm256_set1_epi64x( 0x4330000000000000LL ) );
+        return _mm256_sub_pd( _mm256_castsi256_pd( bits ), _mm256_set1_pd( 4503599627370496.0 + 1023.0 ) );
+    }
+
+    static Type pow2( Type n )
+    {
+        __m256i bits = _mm256_castpd_si256( _mm256_add_pd( n, _mm256_set1_pd( 4503599627370496.0 + 1023.0 ) ) );
+        return _mm256_castsi256_pd( _mm256_slli_epi64( bits, 52 ) );
+    }
+
+    static Type round( Type x )
+    {
+        return _mm256_round_pd( x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC );
+    }
+
+    static Type bit( Type n, int b )
+    {
+        __m256i bits = _mm256_castpd_si256( _mm256_add_pd( n, _mm256_set1_pd( 4503599627370496.0 ) ) );
+        bits = _mm256_and_si256( _mm256_srli_epi64( bits, b ), _mm256_set1_epi64x( 1 ) );
+        return _mm256_castsi256_pd( _mm256_sub_epi64( _mm256_setzero_si256(), bits ) );
+    }
+
+    static Type productError( Type a, Type b, Type p ) { return _mm256_fmsub_pd( a, b, p ); }
+};
+
+template<int N, Variant VARIANT>
+class MandelbrotFunctorAVX2 : public FunctorAVX2, public MandelbrotFastParams
+{
+public:
+    MandelbrotFunctorAVX2( const MandelbrotFastParams& params ) : MandelbrotFastParams( params )
+    {
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        calculateFastVector<VectorAVX2, N, VARIANT, false>( result, zx, zy, count, 0.0, 0.0, m_tolerance, maxIterations, m_cancellation );
+    }
+
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
+    {
+        calculateFastVector<VectorAVX2, N, VARIANT, false>( result, x, y, count, 0.0, 0.0, m_tolerance, maxIterations, m_cancellation, &state );
+        return true;
+    }
+};
+
+template<int N, Variant VARIANT>
+class JuliaFunctorAVX2 : public FunctorAVX2, public JuliaFastParams
+{
+public:
+    JuliaFunctorAVX2( const JuliaFastParams& params ) : JuliaFastParams( params )
+    {
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        calculateFastVector<VectorAVX2, N, VARIANT, true>( result, zx, zy, count, m_cx, m_cy, m_tolerance, maxIterations, m_cancellation );
+    }
+
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
+    {
+        calculateFastVector<VectorAVX2, N, VARIANT, true>( result, x, y, count, m_cx, m_cy, m_tolerance, maxIterations, m_cancellation, &state );
+        return true;
+    }
+};
+
+FunctorAVX2* createMandelbrotFunctorAVX2( int exponent, Variant variant, double tolerance )
+{
+    return FastFunctorFactory<FunctorAVX2, MandelbrotFunctorAVX2>::create( exponent, variant, MandelbrotFastParams( tolerance ) );
+}
+
+FunctorAVX2* createJuliaFunctorAVX2( double cx, double cy, int exponent, Variant variant, double tolerance )
+{
+    return FastFunctorFactory<FunctorAVX2, JuliaFunctorAVX2>::create( exponent, variant, JuliaFastParams( cx, cy, tolerance ) );
+}
+
+// single precision operations for calculateFastVector
+class VectorFloatAVX2
+{
+public:
+    typedef __m256 Type;
+    typedef float Real;
+
+    static const int Lanes = 8;
+
+    static Type set( double a ) { return _mm256_set1_ps( (float)a ); }
+    static Type setZero() { return _mm256_setzero_ps(); }
+
+    static Type load( const float* p ) { return _mm256_load_ps( p ); }
+    static void store( float* p, Type a ) { _mm256_store_ps( p, a ); }
+
+    static Type add( Type a, Type b ) { return _mm256_add_ps( a, b ); }
+    static Type sub( Type a, Type b ) { return _mm256_sub_ps( a, b ); }
+    static Type mul( Type a, Type b ) { return _mm256_mul_ps( a, b ); }
+    static Type mulAdd( Type a, Type b, Type c ) { return _mm256_fmadd_ps( a, b, c ); }
+    static Type mulSub( Type a, Type b, Type c ) { return _mm256_fmsub_ps( a, b, c ); }
+
+    static Type bitAndNot( Type a, Type b ) { return _mm256_andnot_ps( a, b ); }
+    static Type bitXor( Type a, Type b ) { return _mm256_xor_ps( a, b ); }
+
+    static Type greaterEqual( Type a, Type b ) { return _mm256_cmp_ps( a, b, _CMP_GE_OQ ); }
+    static int moveMask( Type a ) { return _mm256_movemask_ps( a ); }
+};
+
+template<int N, Variant VARIANT>
+class MandelbrotFloatFunctorAVX2 : public FunctorAVX2, public MandelbrotFastParams
+{
+public:
+    MandelbrotFloatFunctorAVX2( const MandelbrotFastParams& params ) : MandelbrotFastParams( params )
+    {
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        calculateFastVector<VectorFloatAVX2, N, VARIANT, false>( result, zx, zy, count, 0.0, 0.0, m_tolerance, maxIterations, m_cancellation );
+    }
+
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
+    {
+        calculateFastVector<VectorFloatAVX2, N, VARIANT, false>( result, x, y, count, 0.0, 0.0, m_tolerance, maxIterations, m_cancellation, &state );
+        return true;
+    }
+};
+
+template<int N, Variant VARIANT>
+class JuliaFloatFunctorAVX2 : public FunctorAVX2, public JuliaFastParams
+{
+public:
+    JuliaFloatFunctorAVX2( const JuliaFastParams& params ) : JuliaFastParams( params )
+    {
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        calculateFastVector<VectorFloatAVX2, N, VARIANT, true>( result, zx, zy, count, m_cx, m_cy, m_tolerance, maxIterations, m_cancellation );
+    }
+
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
+    {
+        calculateFastVector<VectorFloatAVX2, N, VARIANT, true>( result, x, y, count, m_cx, m_cy, m_tolerance, maxIterations, m_cancellation, &state );
+        return true;
+    }
+};
+
+FunctorAVX2* createMandelbrotFloatFunctorAVX2( int exponent, Variant variant, double tolerance )
+{
+    return FastFunctorFactory<FunctorAVX2, MandelbrotFloatFunctorAVX2>::create( exponent, variant, MandelbrotFastParams( tolerance ) );
+}
+
+FunctorAVX2* createJuliaFloatFunctorAVX2( double cx, double cy, int exponent, Variant variant, double tolerance )
+{
+    return FastFunctorFactory<FunctorAVX2, JuliaFloatFunctorAVX2>::create( exponent, variant, JuliaFastParams( cx, cy, tolerance ) );
+}
+
+template<Variant VARIANT>
+class MandelbrotRealFunctorAVX2 : public FunctorAVX2, public MandelbrotParams
+{
+public:
+    MandelbrotRealFunctorAVX2( const MandelbrotParams& params ) : MandelbrotParams( params )
+    {
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        calculateRealVector<VectorAVX2, VARIANT, false>( result, zx, zy, count, 0.0, 0.0, m_exponent, maxIterations, m_cancellation );
+    }
+
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
+    {
+        calculateRealVector<VectorAVX2, VARIANT, false>( result, x, y, count, 0.0, 0.0, m_exponent, maxIterations, m_cancellation, &state );
+        return true;
+    }
+};
+
+template<Variant VARIANT>
+class JuliaRealFunctorAVX2 : public FunctorAVX2, public JuliaParams
+{
+public:
+    JuliaRealFunctorAVX2( const JuliaParams& params ) : JuliaParams( params )
+    {
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        calculateRealVector<VectorAVX2, VARIANT, true>( result, zx, zy, count, m_cx, m_cy, m_exponent, maxIterations, m_cancellation );
+    }
+
+    bool resume( double result[], const double x[], const double y[], const IterationState& state, int count, int maxIterations )
+    {
+        calculateRealVector<VectorAVX2, VARIANT, true>( result, x, y, count, m_cx, m_cy, m_exponent, maxIterations, m_cancellation, &state );
+        return true;
+    }
+};
+
+FunctorAVX2* createMandelbrotRealFunctorAVX2( double exponent, Variant variant )
+{
+    return FunctorFactory<FunctorAVX2, MandelbrotRealFunctorAVX2>::create( variant, MandelbrotParams( exponent ) );
+}
+
+FunctorAVX2* createJuliaRealFunctorAVX2( double cx, double cy, double exponent, Variant variant )
+{
+    return FunctorFactory<FunctorAVX2, JuliaRealFunctorAVX2>::create( variant, JuliaParams( cx, cy, exponent ) );
+}
+
+template<int N, Variant VARIANT>
+class MandelbrotDoubleDoubleFunctorAVX2 : public FunctorAVX2, public DoubleDoubleParams
+{
+public:
+    MandelbrotDoubleDoubleFunctorAVX2( const DoubleDoubleParams& params ) : DoubleDoubleParams( params )
+    {
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        calculateDoubleDoubleVector<VectorAVX2, N, VARIANT, false>( result, zx, zy, count, m_x, m_y, 0.0, 0.0, maxIterations, m_cancellation );
+    }
+};
+
+template<int N, Variant VARIANT>
+class JuliaDoubleDoubleFunctorAVX2 : public FunctorAVX2, public JuliaDoubleDoubleParams
+{
+public:
+    JuliaDoubleDoubleFunctorAVX2( const JuliaDoubleDoubleParams& params ) : JuliaDoubleDoubleParams( params )
+    {
+    }
+
+    void operator()( double result[], const double zx[], const double zy[], int count, int maxIterations )
+    {
+        calculateDoubleDoubleVector<VectorAVX2, N, VARIANT, true>( result, zx, zy, count, m_x, m_y, m_cx, m_cy, maxIterations, m_cancellation );
+    }
+};
+
+FunctorAVX2* createMandelbrotDoubleDoubleFunctorAVX2( const FixedPoint& x, const FixedPoint& y, int exponent, Variant variant )
+{
+    return FastFunctorFactory<FunctorAVX2, MandelbrotDoubleDoubleFunctorAVX2>::create( exponent, variant, DoubleDoubleParams( x, y ) );
+}
+
+FunctorAVX2* createJuliaDoubleDoubleFunctorAVX2( const FixedPoint& x, const FixedPoint& y, double cx, double cy, int exponent, Variant variant )
+{
+    return FastFunctorFactory<FunctorAVX2, JuliaDoubleDoubleFunctorAVX2>::create( exponent, variant, JuliaDoubleDoubleParams( x, y, cx, cy ) );
+}
+
+void generatePreviewAVX2( const Input& input, const Output& output, FunctorAVX2* functor, int maxIterations )
+{
+    PointQueue queue( output );
+    queuePreview( input, output, &queue );
+    queue.calculate( functor, maxIterations );
+}
+
+void generateDetailsAVX2( const Input& input, const Output& output, FunctorAVX2* functor, int maxIterations, double threshold )
+{
+    // the preview is incomplete, so the details are not worth queuing
+    if ( isCancelled( functor->cancellation() ) )
+        return;
+
+    PointQueue queue( output );
+    queueDetails( input, output, threshold, &queue );
+    queue.calculate( functor, maxIterations );
+}
+
+void generateRectanglesAVX2( const Input& input, const Output& output, FunctorAVX2* functor, int maxIterations, double threshold, bool verify )
+{
+    PointQueue queue( output );
+    RectangleSubdivision subdivision( input, output, threshold, verify );
+    while ( !isCancelled( functor->cancellation() ) && subdivision.queuePoints( &queue ) )
+        queue.calculate( functor, maxIterations );
+}
+
+void generateQuadtreeAVX2( const Input& input, const Output& output, FunctorAVX2* functor, int maxIterations, double threshold )
+{
+    PointQueue queue( output );
+    QuadtreeRefinement refinement( input, output, threshold );
+    while ( !isCancelled( functor->cancellation() ) && refinement.queuePoints( &queue ) )
+        queue.calculate( functor, maxIterations );
+}
+
+void resumePointsAVX2( const Input& input, const Output& output, FunctorAVX2* functor, int maxIterations, Continuation* continuation )
+{
+    resumeContinuation( input, output, functor, maxIterations, continuation );
+}
+
+} // namespace GeneratorCore
+
+#endif // defined( HAVE_AVX2 )
@@ -0,0 +1,1136 @@
+/**************************************************************************
+* This file is part of the Fraqtive program
+* Copyright (C) 2004-2012 Michał Męciński
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef GENERATORCORE_P_H
+#define GENERATORCORE_P_H
+
+#include "generatorcore.h"
+
+#include <qglobal.h>
+#include <QRect>
+#include <QVector>
+
+#include <math.h>
+#include <cstdlib>
+
+#if defined( HAVE_SSE2 )
+# include "vectormath_p.h"
+#endif
+
+namespace GeneratorCore
+{
+
+// this header is included by sources compiled with different instruction sets,
+// so everything is kept in an anonymous namespace to prevent the linker from
+// merging code generated for one instruction set into another
+namespace
+{
+
+static const double BailoutRadius = 64.0;
+
+static const double BailoutLog = log( 2.0 * log( BailoutRadius ) );
+
+// the initial number of iterations between saving the point compared with the
+// orbit when detecting cycles; it's doubled after each save, so that a cycle
+// of any length is eventually detected (Brent's algorithm)
+static const int CycleInterval = 16;
+
+// the maximum number of iterations between checking if the calculation
+// is cancelled
+static const int CancellationSteps = 65536;
+
+static inline double calculateResult( int maxIterations, int count, double final, double exponent )
+{
+    if ( count == 0 )
+        return 0.0;
+
+    double value = ( maxIterations - count ) + ( BailoutLog - log( log( sqrt( final ) ) ) ) / log( exponent );
+
+    return sqrt( value );
+}
+
+template<typename BASE, template<Variant VARIANT> class FACTORY>
+class VariantDispatcher
+{
+public:
+    template<typename PARAMS>
+    static BASE* create( Variant variant, const PARAMS& params )
+    {
+        switch ( variant ) {
+            case NormalVariant:
+                return FACTORY<NormalVariant>::create( params );
+            case ConjugateVariant:
+                return FACTORY<ConjugateVariant>::create( params );
+            case AbsoluteVariant:
+                return FACTORY<AbsoluteVariant>::create( params );
+            case AbsoluteImVariant:
+                return FACTORY<AbsoluteImVariant>::create( params );
+        }
+        return NULL;
+    }
+};
+
+template<typename BASE, template<Variant VARIANT> class FUNCTOR>
+class FunctorFactory
+{
+public:
+    template<typename PARAMS>
+    static BASE* create( Variant variant, const PARAMS& params )
+    {
+        return VariantDispatcher<BASE, InnerFactory>::create( variant, params );
+    }
+
+private:
+    template<Variant VARIANT>
+    class InnerFactory
+    {
+    public:
+        template<typename PARAMS>
+        static BASE* create( const PARAMS& params )
+        {
+            return new FUNCTOR<VARIANT>( params );
+        }
+    };
+};
+
+class MandelbrotParams
+{
+public:
+    MandelbrotParams( double exponent ) :
+        m_exponent( exponent )
+    {
+    }
+
+protected:
+    double m_exponent;
+};
+
+class JuliaParams : public MandelbrotParams
+{
+public:
+    JuliaParams( double cx, double cy, double exponent ) : MandelbrotParams( exponent ),
+        m_cx( cx ),
+        m_cy( cy )
+    {
+    }
+
+protected:
+    double m_cx;
+    double m_cy;
+};
+
+class MandelbrotFastParams
+{
+public:
+    MandelbrotFastParams( double tolerance ) :
+        m_tolerance( tolerance )
+    {
+    }
+
+protected:
+    double m_tolerance;
+};
+
+class JuliaFastParams : public MandelbrotFastParams
+{
+public:
+    JuliaFastParams( double cx, double cy, double tolerance ) : MandelbrotFastParams( tolerance ),
+        m_cx( cx ),
+        m_cy( cy )
+    {
+    }
+
+protected:
+    double m_cx;
+    double m_cy;
+};
+
+// checks if the point lies inside the main cardioid or the period-2 bulb of
+// the quadratic Mandelbrot set, so that it would never escape
+static inline bool isInsideMainBulbs( double x, double y )
+{
+    double yy = y * y;
+
+    double xq = x - 0.25;
+    double q = xq * xq + yy;
+    if ( q * ( q + xq ) <= 0.25 * yy )
+        return true;
+
+    double xb = x + 1.0;
+    return xb * xb + yy <= 0.0625;
+}
+
+// a double-double number is the unevaluated sum of two doubles which do not
+// overlap, which gives about 106 bits of mantissa; additions are performed
+// without the second renormalization, so the error is relative to the sum
+// of magnitudes of the operands, which is enough for points of the fractal
+struct DoubleDouble
+{
+    double m_hi;
+    double m_lo;
+};
+
+// assumes that |a| >= |b|
+static inline DoubleDouble quickTwoSum( double a, double b )
+{
+    DoubleDouble result;
+    result.m_hi = a + b;
+    result.m_lo = b - ( result.m_hi - a );
+    return result;
+}
+
+static inline DoubleDouble twoSum( double a, double b )
+{
+    DoubleDouble result;
+    result.m_hi = a + b;
+    double bb = result.m_hi - a;
+    result.m_lo = ( a - ( result.m_hi - bb ) ) + ( b - bb );
+    return result;
+}
+
+// the exact value of a * b - p, where p is the rounded product
+static inline double productError( double a, double b, double p )
+{
+#if defined( FP_FAST_FMA )
+    return fma( a, b, -p );
+#else
+    // Dekker's algorithm, which splits the operands into 26-bit halves
+    double t = 134217729.0 * a;
+    double ah = t - ( t - a );
+    double al = a - ah;
+    t = 134217729.0 * b;
+    double bh = t - ( t - b );
+    double bl = b - bh;
+    return ( ( ah * bh - p ) + ah * bl + al * bh ) + al * bl;
+#endif
+}
+
+static inline DoubleDouble operator -( const DoubleDouble& a )
+{
+    DoubleDouble result;
+    result.m_hi = -a.m_hi;
+    result.m_lo = -a.m_lo;
+    return result;
+}
+
+static inline DoubleDouble operator +( const DoubleDouble& a, double b )
+{
+    DoubleDouble s = twoSum( a.m_hi, b );
+    return quickTwoSum( s.m_hi, s.m_lo + a.m_lo );
+}
+
+static inline DoubleDouble operator +( const DoubleDouble& a, const DoubleDouble& b )
+{
+    DoubleDouble s = twoSum( a.m_hi, b.m_hi );
+    return quickTwoSum( s.m_hi, s.m_lo + ( a.m_lo + b.m_lo ) );
+}
+
+static inline DoubleDouble operator -( const DoubleDouble& a, const DoubleDouble& b )
+{
+    DoubleDouble s = twoSum( a.m_hi, -b.m_hi );
+    return quickTwoSum( s.m_hi, s.m_lo + ( a.m_lo - b.m_lo ) );
+}
+
+static inline DoubleDouble operator *( const DoubleDouble& a, const DoubleDouble& b )
+{
+    double p = a.m_hi * b.m_hi;
+    double e = productError( a.m_hi, b.m_hi, p ) + ( a.m_hi * b.m_lo + a.m_lo * b.m_hi );
+    return quickTwoSum( p, e );
+}
+
+static inline DoubleDouble toDoubleDouble( const FixedPoint& value )
+{
+    double hi = value.toDouble();
+    double lo = ( value - FixedPoint( hi ) ).toDouble();
+    return quickTwoSum( hi, lo );
+}
+
+// z^N for both the scalar and the vector double-double numbers
+template<int N>
+class DoubleDoublePower
+{
+public:
+    template<typename D>
+    static inline void calculate( D& zx, D& zy )
+    {
+        if ( N % 2 == 0 ) {
+            DoubleDoublePower<N / 2>::calculate( zx, zy );
+
+            D zxy = zx * zy;
+
+            zx = zx * zx - zy * zy;
+            zy = zxy + zxy;
+        } else {
+            D zx2 = zx;
+            D zy2 = zy;
+            DoubleDoublePower<N - 1>::calculate( zx2, zy2 );
+
+            D t = zx * zx2 - zy * zy2;
+
+            zy = zx * zy2 + zy * zx2;
+            zx = t;
+        }
+    }
+};
+
+template<>
+class DoubleDoublePower<1>
+{
+public:
+    template<typename D>
+    static inline void calculate( D& /*zx*/, D& /*zy*/ )
+    {
+    }
+};
+
+// the coordinates passed to the double-double functors are relative to the
+// center, which is stored with the full double-double precision
+class DoubleDoubleParams
+{
+public:
+    DoubleDoubleParams( const FixedPoint& x, const FixedPoint& y ) :
+        m_x( toDoubleDouble( x ) ),
+        m_y( toDoubleDouble( y ) )
+    {
+    }
+
+protected:
+    DoubleDouble m_x;
+    DoubleDouble m_y;
+};
+
+class JuliaDoubleDoubleParams : public DoubleDoubleParams
+{
+public:
+    JuliaDoubleDoubleParams( const FixedPoint& x, const FixedPoint& y, double cx, double cy ) : DoubleDoubleParams( x, y ),
+        m_cx( cx ),
+        m_cy( cy )
+    {
+    }
+
+protected:
+    double m_cx;
+    double m_cy;
+};
+
+template<typename BASE, template<int N, Variant VARIANT> class FACTORY, int EXPONENT = MaxExponent>
+class ExponentDispatcher
+{
+public:
+    template<typename PARAMS>
+    static BASE* create( int exponent, Variant variant, const PARAMS& params )
+    {
+        if ( exponent == EXPONENT )
+            return VariantDispatcher<BASE, FactoryAdapter>::create( variant, params );
+        return ExponentDispatcher<BASE, FACTORY, EXPONENT - 1>::create( exponent, variant, params );
+    }
+
+private:
+    template<Variant VARIANT>
+    class FactoryAdapter
+    {
+    public:
+        template<typename PARAMS>
+        static BASE* create( const PARAMS& params )
+        {
+            return FACTORY<EXPONENT, VARIANT>::create( params );
+        }
+    };
+};
+
+template<typename BASE, template<int N, Variant VARIANT> class FACTORY>
+class ExponentDispatcher<BASE, FACTORY, 1>
+{
+public:
+    template<typename PARAMS>
+    static BASE* create( int /*exponent*/, Variant /*variant*/, const PARAMS& /*params*/ )
+    {
+        return NULL;
+    }
+};
+
+template<typename BASE, template<int N, Variant VARIANT> class FUNCTOR>
+class FastFunctorFactory
+{
+public:
+    template<typename PARAMS>
+    static BASE* create( int exponent, Variant variant, const PARAMS& params )
+    {
+        return ExponentDispatcher<BASE, InnerFactory>::create( exponent, variant, params );
+    }
+
+private:
+    template<int N, Variant VARIANT>
+    class InnerFactory
+    {
+    public:
+        template<typename PARAMS>
+        static BASE* create( const PARAMS& params )
+        {
+            return new FUNCTOR<N, VARIANT>( params );
+        }
+    };
+};
+
+static inline bool isCancelled( const Cancellation* cancellation )
+{
+    return cancellation != NULL && cancellation->isCancelled();
+}
+
+static inline bool checkThreshold( double p1, double p2, double threshold )
+{
+    double pmin, pmax;
+    if ( p1 < p2 )
+        pmin = p1, pmax = p2;
+    else
+        pmin = p2, pmax = p1;
+
+    if ( pmin == 0.0 && pmax != 0.0 )
+        return true;
+
+    if ( ( pmax - pmin ) > threshold )
+        return true;
+
+    return false;
+}
+
+static inline bool checkThreshold( double p1, double p2, double p3, double p4, double threshold )
+{
+    return checkThreshold( p1, p2, threshold )
+        || checkThreshold( p3, p4, threshold )
+        || checkThreshold( p1, p3, threshold )
+        || checkThreshold( p2, p4, threshold );
+}
+
+#if defined( HAVE_SSE2 )
+
+#if defined( Q_CC_MSVC )
+# define ALIGNSIMD( var ) __declspec(align(32)) var
+#else
+# define ALIGNSIMD( var ) var __attribute__((aligned(32)))
+#endif
+
+// feeds a stream of points into the lanes of a vector kernel; whenever a lane
+// escapes or runs out of iterations, the next point is loaded into it so that
+// no lane stays idle while the others are still iterating; REAL is the type
+// of the lanes, which may be float for the single precision kernels; when
+// skipInterior is set, points inside the main bulbs of the quadratic Mandelbrot
+// set are not loaded and their result is zero; when detectCycles is set, the
+// queue also keeps the points of the orbits saved for cycle detection; when
+// the state is given, the points are resumed from it and it's updated for
+// the points which don't escape; when the calculation is cancelled, all lanes
+// become idle and the remaining results are undefined
+template<int LANES, bool JULIA, typename REAL = double>
+class LaneQueue
+{
+public:
+    LaneQueue( double result[], const double x[], const double y[], int count, double cx, double cy, int maxIterations, double exponent,
+        const Cancellation* cancellation, bool skipInterior = false, bool detectCycles = false, const IterationState* state = NULL ) :
+        m_result( result ),
+        m_x( x ),
+        m_y( y ),
+        m_count( count ),
+        m_next( 0 ),
+        m_active( 0 ),
+        m_cx( cx ),
+        m_cy( cy ),
+        m_maxIterations( maxIterations ),
+        m_exponent( exponent ),
+        m_skipInterior( skipInterior ),
+        m_detectCycles( detectCycles ),
+        m_state( state ),
+        m_cancellation( cancellation )
+    {
+        for ( int i = 0; i < LANES; i++ )
+            load( i );
+    }
+
+    int activeLanes() const { return m_active; }
+
+    // the number of steps until any lane runs out of iterations or reaches
+    // the point at which its orbit is saved; deep orbits are interrupted to
+    // check if the calculation is cancelled
+    int minimumRemaining() const
+    {
+        int minimum = m_cancellation ? qMin( m_maxIterations, CancellationSteps ) : m_maxIterations;
+        for ( int i = 0; i < LANES; i++ ) {
+            if ( ( m_active & ( 1 << i ) ) && m_remaining[ i ] - m_checkpoint[ i ] < minimum )
+                minimum = m_remaining[ i ] - m_checkpoint[ i ];
+        }
+        return minimum;
+    }
+
+    // returns the mask of lanes which were reloaded or became idle; lanes
+    // in the cycled mask are assumed to be periodic and their result is zero
+    int advance( int steps, int escaped, int cycled = 0 )
+    {
+        // the points which are being calculated are abandoned
+        if ( isCancelled( m_cancellation ) ) {
+            m_active = 0;
+            return 0;
+        }
+
+        int reloaded = 0;
+
+        for ( int i = 0; i < LANES; i++ ) {
+            if ( !( m_active & ( 1 << i ) ) )
+                continue;
+
+            m_remaining[ i ] -= steps;
+
+            if ( escaped & ( 1 << i ) ) {
+                m_result[ m_index[ i ] ] = calculateResult( m_maxIterations, m_remaining[ i ] + 1, m_radius[ i ], m_exponent );
+                load( i );
+                reloaded |= 1 << i;
+            } else if ( m_remaining[ i ] == 0 || ( cycled & ( 1 << i ) ) ) {
+                m_result[ m_index[ i ] ] = 0.0;
+                if ( m_state ) {
+                    m_state->m_zx[ m_index[ i ] ] = m_zx[ i ];
+                    m_state->m_zy[ m_index[ i ] ] = m_zy[ i ];
+                    m_state->m_iterations[ m_index[ i ] ] = m_maxIterations - m_remaining[ i ];
+                }
+                load( i );
+                reloaded |= 1 << i;
+            } else if ( m_remaining[ i ] == m_checkpoint[ i ] ) {
+                m_px[ i ] = m_zx[ i ];
+                m_py[ i ] = m_zy[ i ];
+                m_interval[ i ] = qMin( 2 * m_interval[ i ], m_maxIterations );
+                m_checkpoint[ i ] = qMax( m_remaining[ i ] - m_interval[ i ], 0 );
+            }
+        }
+
+        return reloaded;
+    }
+
+public:
+    ALIGNSIMD( REAL m_zx[ LANES ] );
+    ALIGNSIMD( REAL m_zy[ LANES ] );
+    ALIGNSIMD( REAL m_lcx[ LANES ] );
+    ALIGNSIMD( REAL m_lcy[ LANES ] );
+    ALIGNSIMD( REAL m_radius[ LANES ] );
+    ALIGNSIMD( REAL m_px[ LANES ] );
+    ALIGNSIMD( REAL m_py[ LANES ] );
+
+private:
+    void load( int lane )
+    {
+        while ( m_skipInterior && m_next < m_count && isInsideMainBulbs( m_x[ m_next ], m_y[ m_next ] ) )
+            m_result[ m_next++ ] = 0.0;
+
+        if ( m_next < m_count ) {
+            int remaining = m_maxIterations;
+            if ( m_state && m_state->m_iterations[ m_next ] != 0 ) {
+                m_zx[ lane ] = (REAL)m_state->m_zx[ m_next ];
+                m_zy[ lane ] = (REAL)m_state->m_zy[ m_next ];
+                remaining -= m_state->m_iterations[ m_next ];
+            } else {
+                m_zx[ lane ] = m_x[ m_next ];
+                m_zy[ lane ] = m_y[ m_next ];
+            }
+            m_lcx[ lane ] = JULIA ? m_cx : m_x[ m_next ];
+            m_lcy[ lane ] = JULIA ? m_cy : m_y[ m_next ];
+            m_px[ lane ] = m_zx[ lane ];
+            m_py[ lane ] = m_zy[ lane ];
+            m_index[ lane ] = m_next++;
+            m_remaining[ lane ] = remaining;
+            m_interval[ lane ] = CycleInterval;
+            m_checkpoint[ lane ] = m_detectCycles ? qMax( remaining - CycleInterval, 0 ) : 0;
+            m_active |= 1 << lane;
+        } else {
+            // an idle lane keeps iterating zero, which never escapes
+            m_zx[ lane ] = m_zy[ lane ] = 0;
+            m_lcx[ lane ] = m_lcy[ lane ] = 0;
+            m_px[ lane ] = m_py[ lane ] = 0;
+            m_active &= ~( 1 << lane );
+        }
+    }
+
+private:
+    double* m_result;
+    const double* m_x;
+    const double* m_y;
+    int m_count;
+    int m_next;
+
+    int m_index[ LANES ];
+    int m_remaining[ LANES ];
+    int m_interval[ LANES ];
+    int m_checkpoint[ LANES ];
+    int m_active;
+
+    double m_cx;
+    double m_cy;
+
+    int m_maxIterations;
+    double m_exponent;
+
+    bool m_skipInterior;
+    bool m_detectCycles;
+
+    const IterationState* m_state;
+
+    const Cancellation* m_cancellation;
+};
+
+template<typename V, Variant VARIANT>
+static inline void adjustVector( typename V::Type& zx, typename V::Type& zy )
+{
+    typename V::Type sign = V::set( -0.0 );
+
+    switch ( VARIANT ) {
+        case NormalVariant:
+            break;
+        case ConjugateVariant:
+            zy = V::bitXor( sign, zy );
+            break;
+        case AbsoluteVariant:
+            zx = V::bitAndNot( sign, zx );
+            zy = V::bitAndNot( sign, zy );
+            break;
+        case AbsoluteImVariant:
+            zy = V::bitAndNot( sign, zy );
+            break;
+    }
+}
+
+// the multiplications are fused with the additions when the instruction set
+// supports it
+template<typename V, int N>
+class VectorPower
+{
+public:
+    typedef typename V::Type T;
+
+    static inline void calculate( T& zx, T& zy, T& radius )
+    {
+        if ( N % 2 == 0 ) {
+            VectorPower<V, N / 2>::calculate( zx, zy, radius );
+
+            T zyy = V::mul( zy, zy );
+            T zxy = V::mul( zx, zy );
+
+            zx = V::mulSub( zx, zx, zyy );
+            zy = V::add( zxy, zxy );
+        } else {
+            T zx2 = zx;
+            T zy2 = zy;
+            VectorPower<V, N - 1>::calculate( zx2, zy2, radius );
+
+            T zyy2 = V::mul( zy, zy2 );
+            T zyx2 = V::mul( zy, zx2 );
+
+            T zxn = V::mulSub( zx, zx2, zyy2 );
+            zy = V::mulAdd( zx, zy2, zyx2 );
+            zx = zxn;
+        }
+    }
+};
+
+template<typename V>
+class VectorPower<V, 2>
+{
+public:
+    typedef typename V::Type T;
+
+    static inline void calculate( T& zx, T& zy, T& radius )
+    {
+        T zyy = V::mul( zy, zy );
+        T zxy = V::mul( zx, zy );
+
+        radius = V::mulAdd( zx, zx, zyy );
+        zx = V::mulSub( zx, zx, zyy );
+        zy = V::add( zxy, zxy );
+    }
+};
+
+template<typename V>
+class VectorPower<V, 1>
+{
+public:
+    typedef typename V::Type T;
+
+    static inline void calculate( T& /*zx*/, T& /*zy*/, T& /*radius*/ )
+    {
+    }
+};
+
+// kernel for integral exponents, shared by all instruction sets in double and
+// single precision; V::Real is the type of the lanes
+template<typename V, int N, Variant VARIANT, bool JULIA>
+static inline void calculateFastVector( double result[], const double x[], const double y[], int count, double cx, double cy, double tolerance, int maxIterations,
+    const Cancellation* cancellation, const IterationState* state = NULL )
+{
+    typedef typename V::Type T;
+
+    LaneQueue<V::Lanes, JULIA, typename V::Real> lanes( result, x, y, count, cx, cy, maxIterations, N, cancellation, !JULIA && N == 2 && VARIANT == NormalVariant, true, state );
+
+    T rmax = V::set( BailoutRadius );
+    T rtol = V::set( tolerance );
+    T sign = V::set( -0.0 );
+
+    while ( lanes.activeLanes() != 0 ) {
+        int active = lanes.activeLanes();
+
+        T zx = V::load( lanes.m_zx );
+        T zy = V::load( lanes.m_zy );
+        T rcx = V::load( lanes.m_lcx );
+        T rcy = V::load( lanes.m_lcy );
+        T px = V::load( lanes.m_px );
+        T py = V::load( lanes.m_py );
+        T radius = V::setZero();
+
+        // iterate until any lane escapes, returns close to the saved point
+        // or reaches the next checkpoint
+        int steps = lanes.minimumRemaining();
+        int k = steps;
+        int mask = 0;
+        int cycled = 0;
+
+        while ( k > 0 && !( mask | cycled ) ) {
+            adjustVector<V, VARIANT>( zx, zy );
+
+            VectorPower<V, N>::calculate( zx, zy, radius );
+
+            mask = V::moveMask( V::greaterEqual( radius, rmax ) ) & active;
+
+            zx = V::add( zx, rcx );
+            zy = V::add( zy, rcy );
+
+            T distance = V::add( V::bitAndNot( sign, V::sub( zx, px ) ), V::bitAndNot( sign, V::sub( zy, py ) ) );
+            cycled = V::moveMask( V::greaterEqual( rtol, distance ) ) & active;
+
+            k--;
+        }
+
+        V::store( lanes.m_zx, zx );
+        V::store( lanes.m_zy, zy );
+        V::store( lanes.m_radius, radius );
+
+        lanes.advance( steps - k, mask, cycled );
+    }
+}
+
+// polar form kernel for real exponents, shared by all instruction sets
+template<typename V, Variant VARIANT, bool JULIA>
+static inline void calculateRealVector( double result[], const double x[], const double y[], int count, double cx, double cy, double exponent, int maxIterations,
+    const Cancellation* cancellation, const IterationState* state = NULL )
+{
+    typedef typename V::Type T;
+
+    LaneQueue<V::Lanes, JULIA> lanes( result, x, y, count, cx, cy, maxIterations, exponent, cancellation, false, false, state );
+
+    T rmax = V::set( BailoutRadius );
+    T vexp = V::set( exponent );
+    T vexp2 = V::set( 0.5 * exponent );
+
+    while ( lanes.activeLanes() != 0 ) {
+        int active = lanes.activeLanes();
+
+        T zx = V::load( lanes.m_zx );
+        T zy = V::load( lanes.m_zy );
+        T rcx = V::load( lanes.m_lcx );
+        T rcy = V::load( lanes.m_lcy );
+        T radius = V::setZero();
+
+        int steps = lanes.minimumRemaining();
+        int k = steps;
+        int mask = 0;
+
+        while ( k > 0 && !mask ) {
+            adjustVector<V, VARIANT>( zx, zy );
+
+            radius = V::add( V::mul( zx, zx ), V::mul( zy, zy ) );
+
+            mask = V::moveMask( V::greaterEqual( radius, rmax ) ) & active;
+
+            // the remaining lanes must complete the step before the loop exits
+            T z = vectorExp<V>( V::mul( vectorLog<V>( radius ), vexp2 ) );
+            T fi = V::mul( vexp, vectorAtan2<V>( zy, zx ) );
+
+            T s, c;
+            vectorSinCos<V>( fi, s, c );
+
+            zx = V::mulAdd( z, c, rcx );
+            zy = V::mulAdd( z, s, rcy );
+
+            k--;
+        }
+
+        V::store( lanes.m_zx, zx );
+        V::store( lanes.m_zy, zy );
+        V::store( lanes.m_radius, radius );
+
+        lanes.advance( steps - k, mask );
+    }
+}
+
+// the vector counterpart of DoubleDouble; V must provide productError( a, b, p )
+// which returns the exact value of a * b - p
+template<typename V>
+class DoubleDoubleVector
+{
+public:
+    typedef typename V::Type T;
+
+public:
+    DoubleDoubleVector()
+    {
+    }
+
+    DoubleDoubleVector( T hi, T lo ) :
+        m_hi( hi ),
+        m_lo( lo )
+    {
+    }
+
+public:
+    T m_hi;
+    T m_lo;
+};
+
+template<typename V>
+static inline DoubleDoubleVector<V> quickTwoSumVector( typename V::Type a, typename V::Type b )
+{
+    typename V::Type s = V::add( a, b );
+    return DoubleDoubleVector<V>( s, V::sub( b, V::sub( s, a ) ) );
+}
+
+template<typename V>
+static inline DoubleDoubleVector<V> twoSumVector( typename V::Type a, typename V::Type b )
+{
+    typename V::Type s = V::add( a, b );
+    typename V::Type bb = V::sub( s, a );
+    return DoubleDoubleVector<V>( s, V::add( V::sub( a, V::sub( s, bb ) ), V::sub( b, bb ) ) );
+}
+
+template<typename V>
+static inline DoubleDoubleVector<V> operator +( const DoubleDoubleVector<V>& a, const DoubleDoubleVector<V>& b )
+{
+    DoubleDoubleVector<V> s = twoSumVector<V>( a.m_hi, b.m_hi );
+    return quickTwoSumVector<V>( s.m_hi, V::add( s.m_lo, V::add( a.m_lo, b.m_lo ) ) );
+}
+
+template<typename V>
+static inline DoubleDoubleVector<V> operator -( const DoubleDoubleVector<V>& a, const DoubleDoubleVector<V>& b )
+{
+    DoubleDoubleVector<V> s = twoSumVector<V>( a.m_hi, V::bitXor( V::set( -0.0 ), b.m_hi ) );
+    return quickTwoSumVector<V>( s.m_hi, V::add( s.m_lo, V::sub( a.m_lo, b.m_lo ) ) );
+}
+
+template<typename V>
+static inline DoubleDoubleVector<V> operator *( const DoubleDoubleVector<V>& a, const DoubleDoubleVector<V>& b )
+{
+    typename V::Type p = V::mul( a.m_hi, b.m_hi );
+    typename V::Type e = V::add( V::productError( a.m_hi, b.m_hi, p ), V::add( V::mul( a.m_hi, b.m_lo ), V::mul( a.m_lo, b.m_hi ) ) );
+    return quickTwoSumVector<V>( p, e );
+}
+
+template<typename V, Variant VARIANT>
+static inline void adjustDoubleDoubleVector( DoubleDoubleVector<V>& zx, DoubleDoubleVector<V>& zy )
+{
+    typename V::Type sign = V::set( -0.0 );
+
+    // the sign of the number is the sign of its high part
+    switch ( VARIANT ) {
+        case NormalVariant:
+            break;
+        case ConjugateVariant:
+            zy.m_hi = V::bitXor( sign, zy.m_hi );
+            zy.m_lo = V::bitXor( sign, zy.m_lo );
+            break;
+        case AbsoluteVariant: {
+            typename V::Type sx = V::bitAnd( sign, zx.m_hi );
+            zx.m_hi = V::bitXor( sx, zx.m_hi );
+            zx.m_lo = V::bitXor( sx, zx.m_lo );
+        }
+        // fall through
+        case AbsoluteImVariant: {
+            typename V::Type sy = V::bitAnd( sign, zy.m_hi );
+            zy.m_hi = V::bitXor( sy, zy.m_hi );
+            zy.m_lo = V::bitXor( sy, zy.m_lo );
+            break;
+        }
+    }
+}
+
+// double-double kernel for integral exponents, shared by all instruction sets;
+// the lane queue holds the high parts of the points and their offsets from
+// the center are converted to double-double when a lane is loaded
+template<typename V, int N, Variant VARIANT, bool JULIA>
+static inline void calculateDoubleDoubleVector( double result[], const double x[], const double y[], int count,
+    const DoubleDouble& centerX, const DoubleDouble& centerY, double cx, double cy, int maxIterations, const Cancellation* cancellation )
+{
+    typedef typename V::Type T;
+    typedef DoubleDoubleVector<V> D;
+
+    LaneQueue<V::Lanes, JULIA> lanes( result, x, y, count, cx, cy, maxIterations, N, cancellation );
+
+    ALIGNSIMD( double zxl[ V::Lanes ] );
+    ALIGNSIMD( double zyl[ V::Lanes ] );
+    ALIGNSIMD( double lcxl[ V::Lanes ] );
+    ALIGNSIMD( double lcyl[ V::Lanes ] );
+
+    T rmax = V::set( BailoutRadius );
+
+    int reloaded = ( 1 << V::Lanes ) - 1;
+
+    while ( lanes.activeLanes() != 0 ) {
+        int active = lanes.activeLanes();
+
+        for ( int i = 0; i < V::Lanes; i++ ) {
+            if ( !( reloaded & ( 1 << i ) ) )
+                continue;
+
+            if ( active & ( 1 << i ) ) {
+                DoubleDouble zx = centerX + lanes.m_zx[ i ];
+                DoubleDouble zy = centerY + lanes.m_zy[ i ];
+                lanes.m_zx[ i ] = zx.m_hi;
+                lanes.m_zy[ i ] = zy.m_hi;
+                zxl[ i ] = zx.m_lo;
+                zyl[ i ] = zy.m_lo;
+                if ( !JULIA ) {
+                    lanes.m_lcx[ i ] = zx.m_hi;
+                    lanes.m_lcy[ i ] = zy.m_hi;
+                }
+                lcxl[ i ] = JULIA ? 0.0 : zx.m_lo;
+                lcyl[ i ] = JULIA ? 0.0 : zy.m_lo;
+            } else {
+                zxl[ i ] = zyl[ i ] = 0.0;
+                lcxl[ i ] = lcyl[ i ] = 0.0;
+            }
+        }
+
+        D zx( V::load( lanes.m_zx ), V::load( zxl ) );
+        D zy( V::load( lanes.m_zy ), V::load( zyl ) );
+        D rcx( V::load( lanes.m_lcx ), V::load( lcxl ) );
+        D rcy( V::load( lanes.m_lcy ), V::load( lcyl ) );
+        T radius = V::setZero();
+
+        int steps = lanes.minimumRemaining();
+        int k = steps;
+        int mask = 0;
+
+        while ( k > 0 && !mask ) {
+            adjustDoubleDoubleVector<V, VARIANT>( zx, zy );
+
+            radius = V::add( V::mul( zx.m_hi, zx.m_hi ), V::mul( zy.m_hi, zy.m_hi ) );
+
+            mask = V::moveMask( V::greaterEqual( radius, rmax ) ) & active;
+
+            DoubleDoublePower<N>::calculate( zx, zy );
+
+            zx = zx + rcx;
+            zy = zy + rcy;
+
+            k--;
+        }
+
+        V::store( lanes.m_zx, zx.m_hi );
+        V::store( lanes.m_zy, zy.m_hi );
+        V::store( zxl, zx.m_lo );
+        V::store( zyl, zy.m_lo );
+        V::store( lanes.m_radius, radius );
+
+        reloaded = lanes.advance( steps - k, mask );
+    }
+}
+
+#endif // defined( HAVE_SSE2 )
+
+} // anonymous namespace
+
+// collects the points of a region, so that the functor can process all of
+// them in a single stream; when the output has a continuation, the state of
+// the points which don't escape is added to it, if the functor supports it
+class PointQueue
+{
+public:
+    PointQueue( const Output& output );
+    ~PointQueue();
+
+public:
+    void add( double zx, double zy, double* target );
+
+    template<typename FUNCTOR>
+    void calculate( FUNCTOR* functor, int maxIterations )
+    {
+        if ( m_count == 0 )
+            return;
+
+        bool resumable = false;
+        if ( m_continuation ) {
+            for ( int i = 0; i < m_count; i++ )
+                m_iterations[ i ] = 0;
+            IterationState state = { m_stateX, m_stateY, m_iterations, m_reference };
+            resumable = functor->resume( m_result, m_zx, m_zy, state, m_count, maxIterations );
+        }
+
+        if ( !resumable )
+            ( *functor )( m_result, m_zx, m_zy, m_count, maxIterations );
+
+        // the functor stops early when cancelled, leaving the remaining
+        // results uninitialized
+        if ( isCancelled( functor->cancellation() ) ) {
+            m_count = 0;
+            return;
+        }
+
+        for ( int i = 0; i < m_count; i++ ) {
+            *m_targets[ i ] = m_result[ i ];
+            if ( resumable && m_result[ i ] == 0.0 )
+                m_continuation->append( m_targets[ i ] - m_base, m_stateX[ i ], m_stateY[ i ], m_iterations[ i ], m_reference[ i ] );
+        }
+
+        m_count = 0;
+    }
+
+private:
+    void grow();
+
+private:
+    double* m_zx;
+    double* m_zy;
+    double* m_result;
+    double** m_targets;
+
+    Continuation* m_continuation;
+    const double* m_base;
+
+    double* m_stateX;
+    double* m_stateY;
+    int* m_iterations;
+    int* m_reference;
+
+    int m_count;
+    int m_capacity;
+};
+
+// calculates the points of the continuation in a single stream; a functor
+// which cannot resume them calculates them from the beginning
+template<typename FUNCTOR>
+void resumeContinuation( const Input& input, const Output& output, FUNCTOR* functor, int maxIterations, Continuation* continuation )
+{
+    int count = continuation->count();
+    if ( count == 0 )
+        return;
+
+    const int* indexes = continuation->indexes();
+    IterationState state = continuation->state();
+
+    double* x = new double[ count ];
+    double* y = new double[ count ];
+    double* result = new double[ count ];
+
+    for ( int i = 0; i < count; i++ ) {
+        int px = indexes[ i ] % output.m_stride;
+        int py = indexes[ i ] / output.m_stride;
+        x[ i ] = input.m_x + input.m_sa * py + input.m_ca * px;
+        y[ i ] = input.m_y + input.m_ca * py - input.m_sa * px;
+    }
+
+    bool resumable = functor->resume( result, x, y, state, count, maxIterations );
+    if ( !resumable )
+        ( *functor )( result, x, y, count, maxIterations );
+
+    if ( !isCancelled( functor->cancellation() ) ) {
+        for ( int i = 0; i < count; i++ ) {
+            output.m_buffer[ indexes[ i ] ] = result[ i ];
+            if ( resumable && result[ i ] == 0.0 && output.m_continuation )
+                output.m_continuation->append( indexes[ i ], state.m_zx[ i ], state.m_zy[ i ], state.m_iterations[ i ], state.m_reference[ i ] );
+        }
+    }
+
+    delete[] x;
+    delete[] y;
+    delete[] result;
+}
+
+void queuePreview( const Input& input, const Output& output, PointQueue* queue );
+void queueDetails( const Input& input, const Output& output, double threshold, PointQueue* queue );
+
+// calculates the perimeter of rectangles, starting from the whole output, and
+// fills those which are uniform; the others are split into four and processed
+// again, so that each step calculates one stream of points
+class RectangleSubdivision
+{
+public:
+    RectangleSubdivision( const Input& input, const Output& output, double threshold, bool verify );
+    ~RectangleSubdivision();
+
+public:
+    // queues the points needed by the next step, after the previously queued
+    // points were calculated; returns false when the output is complete
+    bool queuePoints( PointQueue* queue );
+
+private:
+    void queuePoint( int x, int y, PointQueue* queue );
+    void queuePerimeter( const QRect& rect, PointQueue* queue );
+    void queueCross( const QRect& rect, PointQueue* queue );
+
+    bool isUniform( const QRect& rect, bool cross ) const;
+
+    void fill( const QRect& rect );
+    void split( const QRect& rect );
+
+private:
+    Input m_input;
+    Output m_output;
+    double m_threshold;
+    bool m_verify;
+
+    bool* m_known;
+
+    QVector<QRect> m_pending;
+    QVector<QRect> m_queued;
+    QVector<QRect> m_verified;
+};
+
+// calculates the corners of cells, starting from a grid of QuadtreeCellSize
+// pixels; each level splits the cells which exceed the threshold into four
+// and interpolates the others
+class QuadtreeRefinement
+{
+public:
+    QuadtreeRefinement( const Input& input, const Output& output, double threshold );
+    ~QuadtreeRefinement();
+
+public:
+    // queues the points needed by the next level, after the previously queued
+    // points were calculated; returns false when the output is complete
+    bool queuePoints( PointQueue* queue );
+
+private:
+    void queuePoint( int x, int y, PointQueue* queue );
+
+    void fill( const QRect& cell );
+    void split( const QRect& cell );
+
+private:
+    Input m_input;
+    Output m_output;
+    double m_threshold;
+
+    bool* m_known;
+
+    QVector<QRect> m_pending;
+    QVector<QRect> m_queued;
+};
+
+} // namespace GeneratorCore
+
+#endif
@@ -19,6 +19,7 @@
 #include "imagegenerator.h"
 
 #include <math.h>
+#include <string.h>
 
 #ifndef M_PI
 # define M_PI 3.14159265358979323846
@@ -36,6 +37,11 @@
 ImageGenerator::ImageGenerator( QObject* parent ) : QObject( parent ),
     m_gradientCache( NULL ),
     m_maximumProgress( 0 ),
+    m_tileColumns( 0 ),
+    m_tileRows( 0 ),
+    m_precision( DoublePrecision ),
+    m_orbit( NULL ),
+    m_orbitPending( false ),
     m_activeJobs( 0 ),
     m_imageCount( 1 ),
     m_currentImage( 0 )
@@ -46,16 +52,25 @@ ImageGenerator::~ImageGenerator()
 {
     QMutexLocker locker( &m_mutex );
 
+    // the jobs which are running are aborted
+    m_cancellation.cancel();
+
     cancelJobs();
+    m_regions.clear();
 
     while ( m_activeJobs > 0 )
         m_allJobsDone.wait( &m_mutex );
 
+    clearTiles();
+
+    delete m_orbit;
+
     delete[] m_gradientCache;
 }
 
-static const int CellsPerRegion = 20;
-static const int RegionSize = CellsPerRegion * GeneratorCore::CellSize + 1;
+// a tile of 97 x 97 points fits in the L2 cache of the processor
+static const int CellsPerTile = 32;
+static const int TileSize = CellsPerTile * GeneratorCore::CellSize + 1;
 
 static int roundToCellSize( int size )
 {
@@ -67,15 +82,11 @@ void ImageGenerator::setResolution( const QSize& resolution )
 {
     m_resolution = resolution;
 
-    int height = resolution.height() + 2;
-
-    int fullRegions = height / ( RegionSize - 2 );
-    int remainder = height - fullRegions * ( RegionSize - 2 );
+    // the buffer has an additional point on each side for anti-aliasing
+    m_tileColumns = ( resolution.width() + 2 + TileSize - 1 ) / TileSize;
+    m_tileRows = ( resolution.height() + 2 + TileSize - 1 ) / TileSize;
 
-    m_maximumProgress = fullRegions;
-
-    if ( remainder > 0 )
-        m_maximumProgress++;
+    m_maximumProgress = m_tileColumns * m_tileRows;
 }
 
 void ImageGenerator::setParameters( const FractalType& type, const Position& position )
@@ -133,21 +144,18 @@ bool ImageGenerator::start()
 
     m_regions.clear();
 
-    int width = roundToCellSize( m_image.width() + 2 );
-    int height = m_image.height() + 2;
-
-    int fullRegions = height / ( RegionSize - 2 );
-    int remainder = height - fullRegions * ( RegionSize - 2 );
+    clearTiles();
 
-    for ( int i = 0; i < fullRegions; i++ ) {
-        QRect region( 0, i * ( RegionSize - 2 ), width, RegionSize );
-        m_regions.append( region );
+    for ( int row = 0; row < m_tileRows; row++ ) {
+        for ( int column = 0; column < m_tileColumns; column++ )
+            m_regions.append( tileRect( column, row ) );
     }
 
-    if ( remainder > 0 ) {
-        QRect region( 0, fullRegions * ( RegionSize - 2 ), width, roundToCellSize( remainder ) );
-        m_regions.append( region );
-    }
+    delete m_orbit;
+    m_orbit = NULL;
+
+    m_precision = DataFunctions::requiredPrecision( m_type, m_position, m_resolution );
+    m_orbitPending = ( m_precision == PerturbationPrecision );
 
     addJobs();
 
@@ -159,16 +167,44 @@ int ImageGenerator::priority() const
     return 1;
 }
 
+bool ImageGenerator::isBackground() const
+{
+    return true;
+}
+
 void ImageGenerator::executeJob()
 {
     QMutexLocker locker( &m_mutex );
 
-    if ( m_regions.count() > 0 )
+    if ( m_orbitPending ) {
+        calculateOrbit();
+        // this job also calculates the first region to keep the progress consistent
+        if ( !m_cancellation.isCancelled() ) {
+            QRect region = m_regions.takeFirst();
+            addJobs();
+            calculateRegion( region );
+        }
+    } else if ( m_regions.count() > 0 ) {
         calculateRegion( m_regions.takeFirst() );
+    }
 
     finishJob();
 }
 
+void ImageGenerator::calculateOrbit()
+{
+    int maxIterations = maximumIterations();
+
+    m_mutex.unlock();
+
+    GeneratorCore::ReferenceOrbit* orbit = DataFunctions::createReferenceOrbit( m_type, m_position, maxIterations, &m_cancellation );
+
+    m_mutex.lock();
+
+    m_orbit = orbit;
+    m_orbitPending = false;
+}
+
 void ImageGenerator::calculateRegion( const QRect& region )
 {
     GeneratorCore::Input input;
@@ -179,38 +215,203 @@ void ImageGenerator::calculateRegion( const QRect& region )
 
     int maxIterations = maximumIterations();
     double threshold = m_generatorSettings.detailThreshold();
+    SamplingMethod method = m_generatorSettings.samplingMethod();
+    bool verify = ( method == VerifiedRectangleSampling );
 
     m_mutex.unlock();
 
+#if defined( HAVE_AVX2 )
+    GeneratorCore::FunctorAVX2* functorAVX2 = DataFunctions::createFunctorAVX2( m_type, m_position, m_resolution, m_precision );
+    if ( functorAVX2 ) {
+        functorAVX2->setCancellation( &m_cancellation );
+        if ( method == GridSampling ) {
+            GeneratorCore::generatePreviewAVX2( input, output, functorAVX2, maxIterations );
+            GeneratorCore::interpolate( output );
+            GeneratorCore::generateDetailsAVX2( input, output, functorAVX2, maxIterations, threshold );
+        } else if ( method == QuadtreeSampling ) {
+            GeneratorCore::generateQuadtreeAVX2( input, output, functorAVX2, maxIterations, threshold );
+        } else {
+            GeneratorCore::generateRectanglesAVX2( input, output, functorAVX2, maxIterations, threshold, verify );
+        }
+        delete functorAVX2;
+    } else {
+#endif
 #if defined( HAVE_SSE2 )
-    GeneratorCore::FunctorSSE2* functorSSE2 = DataFunctions::createFunctorSSE2( m_type );
+    GeneratorCore::FunctorSSE2* functorSSE2 = DataFunctions::createFunctorSSE2( m_type, m_position, m_resolution, m_precision );
     if ( functorSSE2 ) {
-        GeneratorCore::generatePreviewSSE2( input, output, functorSSE2, maxIterations );
-        GeneratorCore::interpolate( output );
-        GeneratorCore::generateDetailsSSE2( input, output, functorSSE2, maxIterations, threshold );
+        functorSSE2->setCancellation( &m_cancellation );
+        if ( method == GridSampling ) {
+            GeneratorCore::generatePreviewSSE2( input, output, functorSSE2, maxIterations );
+            GeneratorCore::interpolate( output );
+            GeneratorCore::generateDetailsSSE2( input, output, functorSSE2, maxIterations, threshold );
+        } else if ( method == QuadtreeSampling ) {
+            GeneratorCore::generateQuadtreeSSE2( input, output, functorSSE2, maxIterations, threshold );
+        } else {
+            GeneratorCore::generateRectanglesSSE2( input, output, functorSSE2, maxIterations, threshold, verify );
+        }
         delete functorSSE2;
     } else {
 #endif
-        GeneratorCore::Functor* functor = DataFunctions::createFunctor( m_type );
+        GeneratorCore::Functor* functor = m_orbit ? DataFunctions::createPerturbationFunctor( m_type, m_orbit ) : DataFunctions::createFunctor( m_type, m_position, m_resolution, m_precision );
         if ( functor ) {
-            GeneratorCore::generatePreview( input, output, functor, maxIterations );
-            GeneratorCore::interpolate( output );
-            GeneratorCore::generateDetails( input, output, functor, maxIterations, threshold );
+            functor->setCancellation( &m_cancellation );
+            if ( method == GridSampling ) {
+                GeneratorCore::generatePreview( input, output, functor, maxIterations );
+                GeneratorCore::interpolate( output );
+                GeneratorCore::generateDetails( input, output, functor, maxIterations, threshold );
+            } else if ( method == QuadtreeSampling ) {
+                GeneratorCore::generateQuadtree( input, output, functor, maxIterations, threshold );
+            } else {
+                GeneratorCore::generateRectangles( input, output, functor, maxIterations, threshold, verify );
+            }
             delete functor;
         }
 #if defined( HAVE_SSE2 )
     }
 #endif
+#if defined( HAVE_AVX2 )
+    }
+#endif
 
     m_mutex.lock();
 
+    if ( m_cancellation.isCancelled() ) {
+        delete[] output.m_buffer;
+        return;
+    }
+
+    int column = region.left() / TileSize;
+    int row = region.top() / TileSize;
+
+    m_tiles.insert( qMakePair( column, row ), output.m_buffer );
+    m_finishedTiles.insert( qMakePair( column, row ) );
+
+    FractalData data;
+    data.setBuffer( output.m_buffer, output.m_stride, region.size() );
+
+    drawPoints( &data, region );
+
+    // the points on both sides of the edges between the tiles are drawn when
+    // the adjacent tiles are also calculated, so that the tiles don't overlap
+    if ( isTileFinished( column - 1, row ) )
+        drawEdge( column - 1, row, true );
+    if ( isTileFinished( column + 1, row ) )
+        drawEdge( column, row, true );
+    if ( isTileFinished( column, row - 1 ) )
+        drawEdge( column, row - 1, false );
+    if ( isTileFinished( column, row + 1 ) )
+        drawEdge( column, row, false );
+
+    for ( int y = row - 1; y <= row; y++ ) {
+        for ( int x = column - 1; x <= column; x++ ) {
+            if ( isTileFinished( x, y ) && isTileFinished( x + 1, y ) && isTileFinished( x, y + 1 ) && isTileFinished( x + 1, y + 1 ) )
+                drawCorner( x, y );
+        }
+    }
+
+    // the tile is no longer needed when all adjacent tiles are drawn
+    for ( int y = row - 1; y <= row + 1; y++ ) {
+        for ( int x = column - 1; x <= column + 1; x++ )
+            releaseTile( x, y );
+    }
+}
+
+QRect ImageGenerator::tileRect( int column, int row ) const
+{
+    int left = column * TileSize;
+    int top = row * TileSize;
+
+    // the last tiles are smaller, but they must also be N * CellSize + 1
+    int width = qMin( TileSize, roundToCellSize( m_resolution.width() + 2 - left ) );
+    int height = qMin( TileSize, roundToCellSize( m_resolution.height() + 2 - top ) );
+
+    return QRect( left, top, width, height );
+}
+
+bool ImageGenerator::isTileFinished( int column, int row ) const
+{
+    if ( column < 0 || row < 0 || column >= m_tileColumns || row >= m_tileRows )
+        return false;
+
+    return m_finishedTiles.contains( qMakePair( column, row ) );
+}
+
+void ImageGenerator::drawEdge( int column, int row, bool vertical )
+{
+    // two points of the tile and of the next one on each side of the edge
+    QRect tile = tileRect( column, row );
+    if ( vertical )
+        drawSeam( QRect( tile.right() - 1, tile.top(), 4, tile.height() ) );
+    else
+        drawSeam( QRect( tile.left(), tile.bottom() - 1, tile.width(), 4 ) );
+}
+
+void ImageGenerator::drawCorner( int column, int row )
+{
+    QRect tile = tileRect( column, row );
+    drawSeam( QRect( tile.right() - 1, tile.bottom() - 1, 4, 4 ) );
+}
+
+void ImageGenerator::drawSeam( const QRect& points )
+{
+    double* buffer = new double[ points.width() * points.height() ];
+
+    // copy the points from all the tiles which contain them
+    for ( int row = points.top() / TileSize; row <= points.bottom() / TileSize; row++ ) {
+        for ( int column = points.left() / TileSize; column <= points.right() / TileSize; column++ ) {
+            QRect tile = tileRect( column, row );
+            QRect common = tile.intersected( points );
+            const double* source = m_tiles.value( qMakePair( column, row ) );
+
+            for ( int y = common.top(); y <= common.bottom(); y++ ) {
+                memcpy( buffer + ( y - points.top() ) * points.width() + common.left() - points.left(),
+                    source + ( y - tile.top() ) * tile.width() + common.left() - tile.left(), common.width() * sizeof( double ) );
+            }
+        }
+    }
+
     FractalData data;
-    data.transferBuffer( output.m_buffer, output.m_stride, region.size() );
+    data.transferBuffer( buffer, points.width(), points.size() );
+
+    drawPoints( &data, points );
+}
+
+void ImageGenerator::drawPoints( const FractalData* data, const QRect& points )
+{
+    // each pixel is calculated from the 3 x 3 points starting at its position
+    QRect pixels = QRect( points.topLeft(), points.size() - QSize( 2, 2 ) ).intersected( m_image.rect() );
+    if ( pixels.isEmpty() )
+        return;
 
     DataFunctions::ColorMapper mapper( m_gradientCache, GradientSize, m_backgroundColor.rgb(), m_colorMapping );
 
-    DataFunctions::drawImage( m_image, region.topLeft(), &data, QRect( 0, 0, m_image.width(), qMin( region.height() - 2, m_image.height() - region.top() ) ),
-        mapper, m_viewSettings.antiAliasing() );
+    DataFunctions::drawImage( m_image, pixels.topLeft(), data, pixels.translated( -points.topLeft() ), mapper, m_viewSettings.antiAliasing() );
+}
+
+void ImageGenerator::releaseTile( int column, int row )
+{
+    if ( !m_tiles.contains( qMakePair( column, row ) ) )
+        return;
+
+    for ( int y = row - 1; y <= row + 1; y++ ) {
+        for ( int x = column - 1; x <= column + 1; x++ ) {
+            bool outside = x < 0 || y < 0 || x >= m_tileColumns || y >= m_tileRows;
+            if ( !outside && !isTileFinished( x, y ) )
+                return;
+        }
+    }
+
+    delete[] m_tiles.take( qMakePair( column, row ) );
+}
+
+void ImageGenerator::clearTiles()
+{
+    QHash<QPair<int, int>, double*>::const_iterator it;
+    for ( it = m_tiles.constBegin(); it != m_tiles.constEnd(); ++it )
+        delete[] it.value();
+
+    m_tiles.clear();
+    m_finishedTiles.clear();
 }
 
 void ImageGenerator::calculateInput( GeneratorCore::Input* input, const QRect& region )
@@ -223,10 +424,13 @@ void ImageGenerator::calculateInput( GeneratorCore::Input* input, const QRect& r
     double offsetX = (double)region.left() - (double)m_image.width() / 2.0 - 0.5;
     double offsetY = (double)region.top() - (double)m_image.height() / 2.0 - 0.5;
 
+    // the extended precision functors use coordinates relative to the center
+    QPointF center = ( m_precision >= DoubleDoublePrecision ) ? QPointF() : m_position.center();
+
     input->m_sa = sa;
     input->m_ca = ca;
-    input->m_x = m_position.center().x() + ca * offsetX + sa * offsetY;
-    input->m_y = m_position.center().y() - sa * offsetX + ca * offsetY;
+    input->m_x = center.x() + ca * offsetX + sa * offsetY;
+    input->m_y = center.y() - sa * offsetX + ca * offsetY;
 }
 
 void ImageGenerator::calculateOutput( GeneratorCore::Output* output, const QRect& region )
@@ -235,6 +439,8 @@ void ImageGenerator::calculateOutput( GeneratorCore::Output* output, const QRect
     output->m_stride = region.width();
     output->m_width = region.width();
     output->m_height = region.height();
+    output->m_known = NULL;
+    output->m_continuation = NULL;
 }
 
 int ImageGenerator::maximumIterations() const
@@ -244,7 +450,8 @@ int ImageGenerator::maximumIterations() const
 
 void ImageGenerator::addJobs()
 {
-    int count = m_regions.count();
+    // the orbit must be calculated before the regions
+    int count = m_orbitPending ? 1 : m_regions.count();
     if ( count > 0 ) {
         fraqtive()->jobScheduler()->addJobs( this, count );
         m_activeJobs += count;
@@ -20,6 +20,8 @@
 #define IMAGEGENERATOR_H
 
 #include <QObject>
+#include <QHash>
+#include <QSet>
 #include <QMutex>
 #include <QWaitCondition>
 #include <QImage>
@@ -27,6 +29,8 @@
 #include "abstractjobprovider.h"
 #include "datastructures.h"
 
+class FractalData;
+
 class ImageGenerator : public QObject, public AbstractJobProvider
 {
     Q_OBJECT
@@ -53,6 +57,8 @@ public:
 public: // AbstractJobProvider implementation
     int priority() const;
 
+    bool isBackground() const;
+
     void executeJob();
 
 signals:
@@ -60,8 +66,20 @@ signals:
     void completed();
 
 private:
+    void calculateOrbit();
     void calculateRegion( const QRect& region );
 
+    QRect tileRect( int column, int row ) const;
+    bool isTileFinished( int column, int row ) const;
+
+    void drawEdge( int column, int row, bool vertical );
+    void drawCorner( int column, int row );
+    void drawSeam( const QRect& points );
+    void drawPoints( const FractalData* data, const QRect& points );
+
+    void releaseTile( int column, int row );
+    void clearTiles();
+
     void calculateInput( GeneratorCore::Input* input, const QRect& region );
     void calculateOutput( GeneratorCore::Output* output, const QRect& region );
 
@@ -86,12 +104,26 @@ private:
 
     int m_maximumProgress;
 
+    int m_tileColumns;
+    int m_tileRows;
+
     QMutex m_mutex;
 
     QImage m_image;
 
     QList<QRect> m_regions;
 
+    // the tiles are kept until the edges with the adjacent tiles are drawn
+    QHash<QPair<int, int>, double*> m_tiles;
+    QSet<QPair<int, int> > m_finishedTiles;
+
+    Precision m_precision;
+
+    GeneratorCore::ReferenceOrbit* m_orbit;
+    bool m_orbitPending;
+
+    GeneratorCore::Cancellation m_cancellation;
+
     int m_activeJobs;
     QWaitCondition m_allJobsDone;
 
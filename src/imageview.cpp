@@ -63,7 +63,8 @@ void ImageView::setInteractive( bool interactive )
 void ImageView::clearView()
 {
     m_image = QImage();
-    m_updatedRegion = QRect();
+    m_updatedRegion = QRegion();
+    m_coarseRegion = QRegion();
     m_tracking = NoTracking;
 
     if ( m_interactive ) {
@@ -88,7 +89,8 @@ void ImageView::transformView( const QTransform& transform )
     painter.drawImage( 0, 0, m_image );
 
     m_image = image;
-    m_updatedRegion = QRect();
+    m_updatedRegion = QRegion();
+    m_coarseRegion = QRegion();
 
     calculateScale();
     update();
@@ -113,22 +115,45 @@ void ImageView::initialUpdate( const FractalData* data )
         update();
     }
 
-    m_updatedRegion = QRect();
+    m_updatedRegion = QRegion();
+    m_coarseRegion = QRegion();
     partialUpdate( data );
 }
 
+static QRegion drawableRegion( const QRegion& region )
+{
+    // a pixel of the image is drawn from 3x3 pixels of data starting at the same position
+    QRegion horizontal = region & region.translated( -1, 0 ) & region.translated( -2, 0 );
+    return horizontal & horizontal.translated( 0, -1 ) & horizontal.translated( 0, -2 );
+}
+
 void ImageView::partialUpdate( const FractalData* data )
 {
     const QList<QRect> validRegions = data->validRegions();
+    const QList<QRect> coarseRegions = data->coarseRegions();
+
+    QRegion valid;
+    for ( int i = 0; i < validRegions.count(); i++ )
+        valid += validRegions[ i ];
 
-    if ( validRegions.count() > 0 && validRegions.first().top() == 0 && validRegions.first().bottom() > m_updatedRegion.bottom() ) {
-        int top = qMax( m_updatedRegion.bottom() - 1, 0 );
-        QRect region( 0, top, validRegions.first().width() - 2, validRegions.first().bottom() - top - 1 ); 
-        drawImage( data, region );
-        m_updatedRegion = validRegions.first();
+    QRegion known = valid;
+    for ( int i = 0; i < coarseRegions.count(); i++ )
+        known += coarseRegions[ i ];
 
-        update( worldTransform().mapRect( region ).adjusted( -1, -1, 1, 1 ) );
+    QRegion exact = drawableRegion( valid );
+    QRegion coarse = drawableRegion( known ) - exact;
+
+    // coarse pixels are drawn once and replaced when their details are calculated
+    QRegion region = ( exact - m_updatedRegion ) + ( coarse - m_coarseRegion );
+
+    const QVector<QRect> rects = region.rects();
+    for ( int i = 0; i < rects.count(); i++ ) {
+        drawImage( data, rects[ i ] );
+        update( worldTransform().mapRect( rects[ i ] ).adjusted( -1, -1, 1, 1 ) );
     }
+
+    m_updatedRegion = exact;
+    m_coarseRegion = coarse;
 }
 
 void ImageView::fullUpdate( const FractalData* data )
@@ -137,6 +162,7 @@ void ImageView::fullUpdate( const FractalData* data )
     drawImage( data, m_image.rect() );
 
     m_updatedRegion = m_image.rect();
+    m_coarseRegion = QRegion();
 
     calculateScale();
     update();
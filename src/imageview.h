@@ -110,7 +110,8 @@ private:
 
     QRgb* m_gradientCache;
 
-    QRect m_updatedRegion;
+    QRegion m_updatedRegion;
+    QRegion m_coarseRegion;
 
     QTransform m_scale;
     QTransform m_invScale;
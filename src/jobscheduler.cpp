@@ -20,18 +20,27 @@
 
 #include "abstractjobprovider.h"
 
+#include <limits.h>
+
+#if defined( Q_OS_WIN )
+#include <windows.h>
+#elif defined( Q_OS_LINUX )
+#include <sched.h>
+#endif
+
 JobScheduler::JobScheduler( QObject* parent ) : QObject( parent ),
-    m_stopping( false )
+    m_maximumThreads( 0 ),
+    m_idleScheduling( false ),
+    m_idleTimeout( 60000 ),
+    m_stopping( false ),
+    m_backgroundJobs( 0 )
 {
-    int threads = QThread::idealThreadCount();
-    if ( threads < 0 )
-        threads = 1;
-
-    for ( int i = 0; i < threads; i++ ) {
-        WorkerThread* thread = new WorkerThread( this );
-        thread->start( QThread::LowPriority );
-        m_threads.append( thread );
-    }
+    m_pool.m_idleThreads = 0;
+    m_pool.m_wokenThreads = 0;
+    m_pool.m_retiringThreads = 0;
+    m_backgroundPool.m_idleThreads = 0;
+    m_backgroundPool.m_wokenThreads = 0;
+    m_backgroundPool.m_retiringThreads = 0;
 }
 
 JobScheduler::~JobScheduler()
@@ -40,57 +49,405 @@ JobScheduler::~JobScheduler()
 
     m_stopping = true;
 
-    m_hasPendingProviders.wakeAll();
+    m_pool.m_hasPendingJobs.wakeAll();
+    m_backgroundPool.m_hasPendingJobs.wakeAll();
 
     locker.unlock();
 
-    for ( int i = 0; i < m_threads.count(); i++ )
-        m_threads[ i ]->wait();
+    for ( int i = 0; i < m_pool.m_threads.count(); i++ )
+        m_pool.m_threads[ i ]->wait();
+    for ( int i = 0; i < m_backgroundPool.m_threads.count(); i++ )
+        m_backgroundPool.m_threads[ i ]->wait();
+
+    qDeleteAll( m_providers );
+}
+
+void JobScheduler::setMaximumThreads( int count )
+{
+    m_maximumThreads = qMax( count, 0 );
+}
+
+static bool isProcessorAvailable( int processor )
+{
+    if ( processor < 0 || processor >= JobScheduler::processorLimit() )
+        return false;
+
+#if defined( Q_OS_WIN )
+    DWORD_PTR processMask;
+    DWORD_PTR systemMask;
+    if ( GetProcessAffinityMask( GetCurrentProcess(), &processMask, &systemMask ) )
+        return ( processMask & ( (DWORD_PTR)1 << processor ) ) != 0;
+#elif defined( Q_OS_LINUX )
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    if ( sched_getaffinity( 0, sizeof( set ), &set ) == 0 )
+        return CPU_ISSET( processor, &set );
+#endif
+
+    return true;
+}
+
+void JobScheduler::setProcessors( const QList<int>& processors )
+{
+    // the number of threads depends on the number of valid processors
+    m_processors.clear();
+    for ( int i = 0; i < processors.count(); i++ ) {
+        if ( isProcessorAvailable( processors[ i ] ) && !m_processors.contains( processors[ i ] ) )
+            m_processors.append( processors[ i ] );
+    }
+}
+
+int JobScheduler::processorLimit()
+{
+#if defined( Q_OS_WIN )
+    return (int)sizeof( DWORD_PTR ) * 8;
+#elif defined( Q_OS_LINUX )
+    return CPU_SETSIZE;
+#else
+    return 1024;
+#endif
+}
+
+void JobScheduler::setIdleScheduling( bool enabled )
+{
+    m_idleScheduling = enabled;
+}
+
+void JobScheduler::setIdleTimeout( int timeout )
+{
+    m_idleTimeout = qMax( timeout, 0 );
 }
 
 void JobScheduler::addJobs( AbstractJobProvider* provider, int count )
 {
+    if ( count <= 0 )
+        return;
+
     QMutexLocker locker( &m_mutex );
 
-    int pos = 0;
+    ProviderState* state = m_providers.value( provider );
+    if ( state == NULL ) {
+        state = new ProviderState();
+        state->m_provider = provider;
+        state->m_priority = 0;
+        state->m_background = false;
+        state->m_pendingJobs = 0;
+        state->m_runningJobs = 0;
+        m_providers.insert( provider, state );
+    }
+
+    state->m_maximumJobs = provider->maximumJobs();
+
+    // a provider without pending jobs is appended to its priority class;
+    // it is also moved when its priority or latency class has changed
     int priority = provider->priority();
-    while ( pos < m_pendingProviders.count() && m_pendingProviders[ pos ]->priority() >= priority )
-        pos++;
+    bool background = provider->isBackground();
+    bool changed = state->m_priority != priority || state->m_background != background;
+    if ( state->m_pendingJobs > 0 && changed )
+        unlinkProvider( state );
+    if ( state->m_pendingJobs == 0 )
+        state->m_waitTime.start();
+    if ( state->m_pendingJobs == 0 || changed ) {
+        state->m_priority = priority;
+        state->m_background = background;
+        linkProvider( state );
+    }
+
+    state->m_pendingJobs += count;
 
-    for ( int i = 0; i < count; i++ )
-        m_pendingProviders.insert( pos, provider );
+    // only as many threads are woken as can execute the new jobs
+    int wakeups = count;
+    if ( state->m_maximumJobs > 0 )
+        wakeups = qMin( wakeups, state->m_maximumJobs - state->m_runningJobs );
+    if ( background && !m_idleScheduling )
+        wakeups = qMin( wakeups, qMax( maximumThreads() - 1, 1 ) - m_backgroundJobs );
 
-    m_hasPendingProviders.wakeAll();
+    wakeThreads( poolForJobs( state ), wakeups );
 }
 
 int JobScheduler::cancelAllJobs( AbstractJobProvider* provider )
 {
     QMutexLocker locker( &m_mutex );
 
-    return m_pendingProviders.removeAll( provider );
+    ProviderState* state = m_providers.value( provider );
+    if ( state == NULL )
+        return 0;
+
+    int count = state->m_pendingJobs;
+
+    if ( count > 0 ) {
+        unlinkProvider( state );
+        state->m_pendingJobs = 0;
+    }
+
+    if ( state->m_runningJobs == 0 )
+        removeProvider( state );
+
+    return count;
 }
 
-bool JobScheduler::executeJob()
+bool JobScheduler::executeJob( WorkerThread* thread )
 {
     QMutexLocker locker( &m_mutex );
 
-    while ( !m_stopping && m_pendingProviders.count() == 0 )
-        m_hasPendingProviders.wait( &m_mutex );
+    ThreadPool* pool = thread->isBackground() ? &m_backgroundPool : &m_pool;
 
-    if ( m_stopping )
-        return false;
+    unsigned long timeout = m_idleTimeout > 0 ? (unsigned long)m_idleTimeout : ULONG_MAX;
+    bool timedOut = false;
+
+    ProviderState* state = NULL;
+    for ( ;; ) {
+        if ( m_stopping )
+            return false;
+
+        // a background thread exits when interactive threads were started
+        // in excess of the maximum
+        if ( thread->isBackground() && runningThreads( &m_pool ) + runningThreads( &m_backgroundPool ) > maximumThreads() ) {
+            pool->m_stoppedThreads.append( thread );
+            return false;
+        }
+
+        state = takeJob( thread->isBackground() );
+        if ( state != NULL )
+            break;
+
+        // an interactive thread exits to make room for a background thread
+        // when background jobs are waiting for one; background threads cannot
+        // start interactive ones, because they would inherit the idle class
+        if ( m_idleScheduling && !thread->isBackground() && m_backgroundPool.m_idleThreads - m_backgroundPool.m_wokenThreads <= 0
+            && findProvider( m_backgroundClasses, 0 ) != NULL ) {
+            pool->m_stoppedThreads.append( thread );
+            wakeThreads( &m_backgroundPool, 1 );
+            return false;
+        }
+
+        // the thread exits after being idle for too long; it is started
+        // again when there are jobs to execute
+        if ( timedOut ) {
+            pool->m_stoppedThreads.append( thread );
+            return false;
+        }
 
-    AbstractJobProvider* provider = m_pendingProviders.takeFirst();
+        pool->m_idleThreads++;
+        timedOut = !pool->m_hasPendingJobs.wait( &m_mutex, timeout );
+        pool->m_idleThreads--;
+        if ( !timedOut )
+            pool->m_wokenThreads--;
+
+        // the thread exits to make room for a thread of the other pool
+        if ( pool->m_retiringThreads > 0 ) {
+            pool->m_retiringThreads--;
+            pool->m_stoppedThreads.append( thread );
+            return false;
+        }
+    }
 
     locker.unlock();
 
-    provider->executeJob();
+    state->m_provider->executeJob();
+
+    locker.relock();
+
+    finishJob( state );
 
     return true;
 }
 
-WorkerThread::WorkerThread( JobScheduler* scheduler ) : QThread( scheduler ),
-    m_scheduler( scheduler )
+JobScheduler::ProviderState* JobScheduler::takeJob( bool background )
+{
+    ProviderState* state = NULL;
+
+    if ( background ) {
+        state = findProvider( m_backgroundClasses, 0 );
+    } else if ( m_idleScheduling ) {
+        state = findProvider( m_classes, 0 );
+    } else {
+        bool backgroundAllowed = m_backgroundJobs < qMax( maximumThreads() - 1, 1 );
+
+        if ( backgroundAllowed )
+            state = findProvider( m_backgroundClasses, AgingInterval );
+        if ( state == NULL )
+            state = findProvider( m_classes, 0 );
+        if ( state == NULL && backgroundAllowed )
+            state = findProvider( m_backgroundClasses, 0 );
+    }
+
+    if ( state == NULL )
+        return NULL;
+
+    state->m_runningJobs++;
+    if ( state->m_background )
+        m_backgroundJobs++;
+
+    state->m_waitTime.restart();
+
+    if ( --state->m_pendingJobs == 0 )
+        unlinkProvider( state );
+
+    return state;
+}
+
+void JobScheduler::finishJob( ProviderState* state )
+{
+    bool limited = state->m_maximumJobs > 0 && state->m_runningJobs >= state->m_maximumJobs;
+
+    state->m_runningJobs--;
+    if ( state->m_background )
+        m_backgroundJobs--;
+
+    // an idle thread may be able to execute the next job of this provider
+    // or of another background provider
+    bool wake = ( limited && state->m_pendingJobs > 0 ) || ( state->m_background && !m_backgroundClasses.isEmpty() );
+
+    ThreadPool* pool = poolForJobs( state );
+    if ( wake && pool->m_idleThreads - pool->m_wokenThreads > 0 ) {
+        pool->m_hasPendingJobs.wakeOne();
+        pool->m_wokenThreads++;
+    }
+
+    if ( state->m_pendingJobs == 0 && state->m_runningJobs == 0 )
+        removeProvider( state );
+}
+
+JobScheduler::ProviderState* JobScheduler::findProvider( QMap<int, PriorityClass>& classes, int minimumWait )
+{
+    // the classes are checked starting from the highest priority; a provider
+    // which already executes its maximum number of jobs is skipped
+    QMap<int, PriorityClass>::iterator it = classes.end();
+    while ( it != classes.begin() ) {
+        --it;
+        for ( ProviderState* state = it.value().m_first; state != NULL; state = state->m_next ) {
+            if ( state->m_maximumJobs > 0 && state->m_runningJobs >= state->m_maximumJobs )
+                continue;
+            if ( minimumWait > 0 && state->m_waitTime.elapsed() < minimumWait )
+                continue;
+            return state;
+        }
+    }
+
+    return NULL;
+}
+
+void JobScheduler::linkProvider( ProviderState* state )
+{
+    QMap<int, PriorityClass>& classes = state->m_background ? m_backgroundClasses : m_classes;
+
+    QMap<int, PriorityClass>::iterator it = classes.find( state->m_priority );
+    if ( it == classes.end() ) {
+        PriorityClass priorityClass;
+        priorityClass.m_first = NULL;
+        priorityClass.m_last = NULL;
+        it = classes.insert( state->m_priority, priorityClass );
+    }
+
+    PriorityClass& priorityClass = it.value();
+
+    state->m_previous = priorityClass.m_last;
+    state->m_next = NULL;
+
+    if ( priorityClass.m_last != NULL )
+        priorityClass.m_last->m_next = state;
+    else
+        priorityClass.m_first = state;
+    priorityClass.m_last = state;
+}
+
+void JobScheduler::unlinkProvider( ProviderState* state )
+{
+    QMap<int, PriorityClass>& classes = state->m_background ? m_backgroundClasses : m_classes;
+
+    QMap<int, PriorityClass>::iterator it = classes.find( state->m_priority );
+
+    PriorityClass& priorityClass = it.value();
+
+    if ( state->m_previous != NULL )
+        state->m_previous->m_next = state->m_next;
+    else
+        priorityClass.m_first = state->m_next;
+
+    if ( state->m_next != NULL )
+        state->m_next->m_previous = state->m_previous;
+    else
+        priorityClass.m_last = state->m_previous;
+
+    // empty classes are removed so that they are not checked by takeJob()
+    if ( priorityClass.m_first == NULL )
+        classes.erase( it );
+}
+
+void JobScheduler::removeProvider( ProviderState* state )
+{
+    m_providers.remove( state->m_provider );
+    delete state;
+}
+
+JobScheduler::ThreadPool* JobScheduler::poolForJobs( ProviderState* state )
+{
+    return ( state->m_background && m_idleScheduling ) ? &m_backgroundPool : &m_pool;
+}
+
+void JobScheduler::wakeThreads( ThreadPool* pool, int count )
+{
+    int wakeups = qMin( count, pool->m_idleThreads - pool->m_wokenThreads );
+    for ( int i = 0; i < wakeups; i++ )
+        pool->m_hasPendingJobs.wakeOne();
+    pool->m_wokenThreads += wakeups;
+
+    // start stopped or new threads for the remaining jobs
+    bool background = ( pool == &m_backgroundPool );
+    ThreadPool* other = background ? &m_pool : &m_backgroundPool;
+
+    for ( int i = wakeups; i < count; i++ ) {
+        // the threads of both pools count against the maximum, so an idle
+        // thread of the other pool is stopped to make room for a new one; when
+        // there is none, interactive threads are started anyway and background
+        // threads exit after finishing their current jobs
+        if ( runningThreads( pool ) + runningThreads( other ) >= maximumThreads() ) {
+            if ( other->m_idleThreads - other->m_wokenThreads > 0 ) {
+                other->m_retiringThreads++;
+                other->m_wokenThreads++;
+                other->m_hasPendingJobs.wakeOne();
+            } else if ( background || runningThreads( pool ) >= maximumThreads() ) {
+                break;
+            }
+        }
+
+        WorkerThread* thread;
+        if ( !pool->m_stoppedThreads.isEmpty() ) {
+            thread = pool->m_stoppedThreads.takeFirst();
+            // the thread may still be finishing
+            thread->wait();
+        } else {
+            thread = new WorkerThread( this, background );
+            pool->m_threads.append( thread );
+        }
+
+        if ( background )
+            thread->start( QThread::IdlePriority );
+        else
+            thread->start( m_idleScheduling ? QThread::NormalPriority : QThread::LowPriority );
+    }
+}
+
+int JobScheduler::runningThreads( const ThreadPool* pool ) const
+{
+    return pool->m_threads.count() - pool->m_stoppedThreads.count() - pool->m_retiringThreads;
+}
+
+int JobScheduler::maximumThreads() const
+{
+    if ( m_maximumThreads > 0 )
+        return m_maximumThreads;
+
+    if ( !m_processors.isEmpty() )
+        return m_processors.count();
+
+    return qMax( QThread::idealThreadCount(), 1 );
+}
+
+WorkerThread::WorkerThread( JobScheduler* scheduler, bool background ) : QThread( scheduler ),
+    m_scheduler( scheduler ),
+    m_background( background )
 {
 }
 
@@ -100,6 +457,40 @@ WorkerThread::~WorkerThread()
 
 void WorkerThread::run()
 {
-    while ( m_scheduler->executeJob() )
+    const QList<int>& processors = m_scheduler->m_processors;
+
+#if defined( Q_OS_WIN )
+    if ( !processors.isEmpty() ) {
+        DWORD_PTR mask = 0;
+        for ( int i = 0; i < processors.count(); i++ ) {
+            mask |= (DWORD_PTR)1 << processors[ i ];
+        }
+        if ( mask != 0 )
+            SetThreadAffinityMask( GetCurrentThread(), mask );
+    }
+#elif defined( Q_OS_LINUX )
+    if ( !processors.isEmpty() ) {
+        cpu_set_t set;
+        CPU_ZERO( &set );
+        for ( int i = 0; i < processors.count(); i++ ) {
+            CPU_SET( processors[ i ], &set );
+        }
+        sched_setaffinity( 0, sizeof( set ), &set );
+    }
+
+#if defined( SCHED_IDLE )
+    // the thread cannot return to the normal class, so it only executes
+    // background jobs
+    if ( m_background ) {
+        sched_param param;
+        param.sched_priority = 0;
+        sched_setscheduler( 0, SCHED_IDLE, &param );
+    }
+#endif
+#else
+    Q_UNUSED( processors );
+#endif
+
+    while ( m_scheduler->executeJob( this ) )
         ;
 }
@@ -22,9 +22,30 @@
 #include <QThread>
 #include <QMutex>
 #include <QWaitCondition>
+#include <QHash>
+#include <QMap>
+#include <QTime>
 
 class AbstractJobProvider;
-
+class WorkerThread;
+
+// the scheduler only counts the pending jobs of each provider; providers with
+// pending jobs are grouped in classes of equal priority, in the order in which
+// they were added, so that adding and cancelling jobs takes constant time
+//
+// the jobs of background providers are only executed when no interactive jobs
+// are pending and one thread is reserved for the interactive jobs, so that
+// they start without waiting for a running job; a background provider which
+// has not been served for AgingInterval takes precedence over the interactive
+// jobs, so that it progresses even when the interactive ones keep all other
+// threads busy
+//
+// with idle scheduling, the background jobs are executed by a separate group
+// of threads with the lowest scheduling class of the system instead, so that
+// the interactive jobs preempt them
+//
+// threads are started when jobs are added and exit after being idle for the
+// idle timeout
 class JobScheduler : public QObject
 {
     Q_OBJECT
@@ -33,23 +54,108 @@ public:
     ~JobScheduler();
 
 public:
+    // the options must be set before any jobs are added
+
+    // the maximum number of threads executing jobs, including the threads
+    // of background jobs; 0 means the number of processors in the processor
+    // set or in the system; when interactive jobs are added while background
+    // threads are busy, the background threads exit after their current jobs
+    void setMaximumThreads( int count );
+
+    // the processors which the threads are restricted to; empty means all;
+    // processors which are not available to the process are ignored
+    void setProcessors( const QList<int>& processors );
+
+    // the number of processors which can be given to setProcessors()
+    static int processorLimit();
+
+    void setIdleScheduling( bool enabled );
+
+    // the time in milliseconds after which an idle thread exits; 0 means
+    // that the threads never exit
+    void setIdleTimeout( int timeout );
+
+    int maximumThreads() const;
+
     void addJobs( AbstractJobProvider* provider, int count );
 
     int cancelAllJobs( AbstractJobProvider* provider );
 
 private:
-    bool executeJob();
+    static const int AgingInterval = 250; // milliseconds
+
+    struct ProviderState
+    {
+        AbstractJobProvider* m_provider;
+        int m_priority;
+        bool m_background;
+        int m_maximumJobs;
+        int m_pendingJobs;
+        int m_runningJobs;
+
+        // the time since the provider was last served
+        QTime m_waitTime;
+
+        // the list of providers with pending jobs in the same priority class
+        ProviderState* m_previous;
+        ProviderState* m_next;
+    };
+
+    struct PriorityClass
+    {
+        ProviderState* m_first;
+        ProviderState* m_last;
+    };
+
+    struct ThreadPool
+    {
+        QList<WorkerThread*> m_threads;
+        QList<WorkerThread*> m_stoppedThreads;
+
+        int m_idleThreads;
+        int m_wokenThreads; // idle threads which were woken but didn't resume yet
+        int m_retiringThreads; // idle threads which should exit
+
+        QWaitCondition m_hasPendingJobs;
+    };
+
+private:
+    bool executeJob( WorkerThread* thread );
+
+    ProviderState* takeJob( bool background );
+    void finishJob( ProviderState* state );
+
+    ProviderState* findProvider( QMap<int, PriorityClass>& classes, int minimumWait );
+
+    void linkProvider( ProviderState* state );
+    void unlinkProvider( ProviderState* state );
+
+    void removeProvider( ProviderState* state );
+
+    ThreadPool* poolForJobs( ProviderState* state );
+
+    void wakeThreads( ThreadPool* pool, int count );
+
+    int runningThreads( const ThreadPool* pool ) const;
 
 private:
-    QList<QThread*> m_threads;
+    int m_maximumThreads;
+    QList<int> m_processors;
+    bool m_idleScheduling;
+    int m_idleTimeout;
 
     bool m_stopping;
 
     QMutex m_mutex;
 
-    QList<AbstractJobProvider*> m_pendingProviders;
+    QHash<AbstractJobProvider*, ProviderState*> m_providers;
+    QMap<int, PriorityClass> m_classes;
+    QMap<int, PriorityClass> m_backgroundClasses;
+
+    int m_backgroundJobs;
 
-    QWaitCondition m_hasPendingProviders;
+    ThreadPool m_pool;
+    ThreadPool m_backgroundPool;
 
     friend class WorkerThread;
 };
@@ -58,14 +164,18 @@ class WorkerThread : public QThread
 {
     Q_OBJECT
 public:
-    WorkerThread( JobScheduler* scheduler );
+    WorkerThread( JobScheduler* scheduler, bool background );
     ~WorkerThread();
 
+public:
+    bool isBackground() const { return m_background; }
+
 public: // overrides
     void run();
 
 private:
     JobScheduler* m_scheduler;
+    bool m_background;
 };
 
 #endif
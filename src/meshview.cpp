@@ -74,7 +74,7 @@ void MeshView::clearView()
 
     m_resolution = QSize();
 
-    m_updatedRegion = QRect();
+    m_updatedRegion = QRegion();
 
     updateGL();
 }
@@ -101,7 +101,7 @@ void MeshView::initialUpdate( const FractalData* data )
 
     m_maximumDepth = sqrt( (double)m_presenter->maximumIterations() );
 
-    m_updatedRegion = QRect();
+    m_updatedRegion = QRegion();
     partialUpdate( data );
 }
 
@@ -112,15 +112,21 @@ void MeshView::partialUpdate( const FractalData* data )
 
     const QList<QRect> validRegions = data->validRegions();
 
-    if ( validRegions.count() > 0 && validRegions.first().top() == 0 && validRegions.first().bottom() > m_updatedRegion.bottom() ) {
-        int top = m_updatedRegion.bottom() + 1;
-        QRect region( 0, top, validRegions.first().width(), validRegions.first().bottom() - top + 1 );
-        updateVertices( data, region );
+    QRegion valid;
+    for ( int i = 0; i < validRegions.count(); i++ )
+        valid += validRegions[ i ];
 
-        m_updatedRegion = validRegions.first();
+    // the regions are updated as soon as they are calculated, in any order
+    const QVector<QRect> updated = ( valid - m_updatedRegion ).rects();
+    if ( updated.isEmpty() )
+        return;
 
-        updateGL();
-    }
+    for ( int i = 0; i < updated.count(); i++ )
+        updateVertices( data, updated[ i ] );
+
+    m_updatedRegion = valid;
+
+    updateGL();
 }
 
 void MeshView::fullUpdate( const FractalData* data )
@@ -402,26 +408,30 @@ void MeshView::initializeVertices()
 void MeshView::updateVertices( const FractalData* data, const QRect& region )
 {
     int stride = data->stride();
-    int width = region.width();
+    int width = m_resolution.width();
 
     for ( int y = region.top(); y <= region.bottom(); y++ ) {
-        const double* src = data->buffer() + y * stride + region.left();
+        const double* src = data->buffer() + y * stride;
         float* vertices = m_vertexArray + y * 3 * width;
         float* coords = m_textureCoordArray + y * width;
 
-        double sum = 0.0;
-        int count = 0;
-
-        for ( int x = 0; x < width; x++ ) {
+        for ( int x = region.left(); x <= region.right(); x++ ) {
             double value = src[ x ];
-            if ( value > 0.0 )
-                sum += value, count++;
-            else
+            if ( value <= 0.0 )
                 value = InfiniteDepth;
             vertices[ 3 * x + 2 ] = -(float)value;
             coords[ x ] = (float)value;
         }
 
+        // the rest of the row may still contain the points of the previous view
+        double sum = 0.0;
+        int count = 0;
+
+        for ( int x = 0; x < width; x++ ) {
+            if ( coords[ x ] > 0.0f && coords[ x ] < InfiniteDepth )
+                sum += coords[ x ], count++;
+        }
+
         if ( count > 0 )
             m_averageRowHeight[ y ] = sum / (double)count;
     }
@@ -98,7 +98,7 @@ private:
     float* m_textureCoordArray;
     QSize m_resolution;
 
-    QRect m_updatedRegion;
+    QRegion m_updatedRegion;
 
     double m_maximumDepth;
 
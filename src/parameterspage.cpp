@@ -19,6 +19,7 @@
 #include "parameterspage.h"
 
 #include "fractalmodel.h"
+#include "datafunctions.h"
 #include "fractaltypedialog.h"
 #include "loadbookmarkdialog.h"
 #include "savebookmarkdialog.h"
@@ -83,22 +84,22 @@ void ParametersPage::on_editJuliaY_valueChanged()
 
 void ParametersPage::on_editPositionX_valueChanged()
 {
-    savePosition();
+    savePosition( true );
 }
 
 void ParametersPage::on_editPositionY_valueChanged()
 {
-    savePosition();
+    savePosition( true );
 }
 
 void ParametersPage::on_spinZoom_valueChanged()
 {
-    savePosition();
+    savePosition( false );
 }
 
 void ParametersPage::on_spinAngle_valueChanged()
 {
-    savePosition();
+    savePosition( false );
 }
 
 void ParametersPage::fractalTypeChanged()
@@ -155,6 +156,10 @@ void ParametersPage::loadFractalType()
         exponent = QString::number( type.realExponent(), 'f', 2 );
 
     m_ui.editType->setText( QString( "%1 (%2), N=%3" ).arg( fractal, variant, exponent ) );
+
+    m_loading = true;
+    m_ui.spinZoom->setMaximum( DataFunctions::maximumZoomFactor( type ) );
+    m_loading = false;
 }
 
 void ParametersPage::loadParameters()
@@ -212,11 +217,15 @@ void ParametersPage::loadPosition()
     m_loading = false;
 }
 
-void ParametersPage::savePosition()
+void ParametersPage::savePosition( bool centerChanged )
 {
     if ( !m_loading && !m_model->isTracking() ) {
-        Position position;
-        position.setCenter( QPointF( m_ui.editPositionX->value(), m_ui.editPositionY->value() ) );
+        Position position = m_model->position();
+
+        // the edits only show an approximation of the exact center
+        if ( centerChanged )
+            position.setCenter( QPointF( m_ui.editPositionX->value(), m_ui.editPositionY->value() ) );
+
         position.setZoomFactor( m_ui.spinZoom->value() );
         position.setAngle( m_ui.spinAngle->value() );
         m_model->setPosition( position );
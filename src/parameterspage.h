@@ -60,7 +60,7 @@ private:
     void saveParameters();
 
     void loadPosition();
-    void savePosition();
+    void savePosition( bool centerChanged );
 
 private:
     Ui::ParametersPage m_ui;
@@ -19,6 +19,7 @@ HEADERS   += aboutbox.h \
              datastructures.h \
              doubleedit.h \
              doubleslider.h \
+             fixedpoint.h \
              fractaldata.h \
              fractalgenerator.h \
              fractalmodel.h \
@@ -30,6 +31,7 @@ HEADERS   += aboutbox.h \
              generateimagedialog.h \
              generateseriesdialog.h \
              generatorcore.h \
+             generatorcore_p.h \
              gradientdialog.h \
              gradienteditor.h \
              guidedialog.h \
@@ -48,6 +50,8 @@ HEADERS   += aboutbox.h \
              savebookmarkdialog.h \
              savepresetdialog.h \
              shadewidget.h \
+             tilecache.h \
+             vectormath_p.h \
              viewcontainer.h
 
 SOURCES   += aboutbox.cpp \
@@ -62,6 +66,7 @@ SOURCES   += aboutbox.cpp \
              datastructures.cpp \
              doubleedit.cpp \
              doubleslider.cpp \
+             fixedpoint.cpp \
              fractaldata.cpp \
              fractalgenerator.cpp \
              fractalmodel.cpp \
@@ -91,6 +96,7 @@ SOURCES   += aboutbox.cpp \
              savebookmarkdialog.cpp \
              savepresetdialog.cpp \
              shadewidget.cpp \
+             tilecache.cpp \
              viewcontainer.cpp
 
 FORMS     += advancedsettingspage.ui \
@@ -136,6 +142,25 @@ sse2 {
     SOURCES += generatorcore.cpp
 }
 
+no-avx2|!sse2: CONFIG -= avx2
+
+avx2 {
+    DEFINES += HAVE_AVX2
+    win32-g++|!win32:!*-icc* {
+        AVX2_SOURCES += generatorcore_avx2.cpp
+        avx2_compiler.commands = $$QMAKE_CXX -c -mavx2 -mfma $(CXXFLAGS) $(INCPATH) ${QMAKE_FILE_IN} -o ${QMAKE_FILE_OUT}
+        avx2_compiler.dependency_type = TYPE_C
+        avx2_compiler.output = ${QMAKE_VAR_OBJECTS_DIR}${QMAKE_FILE_BASE}$${first(QMAKE_EXT_OBJ)}
+        avx2_compiler.input = AVX2_SOURCES
+        avx2_compiler.variable_out = OBJECTS
+        avx2_compiler.name = compiling[avx2] ${QMAKE_FILE_IN}
+        silent:avx2_compiler.commands = @echo compiling[avx2] ${QMAKE_FILE_IN} && $$avx2_compiler.commands
+        QMAKE_EXTRA_COMPILERS += avx2_compiler
+    } else {
+        SOURCES += generatorcore_avx2.cpp
+    }
+}
+
 include( xmlui/xmlui.pri )
 
 static {
@@ -0,0 +1,110 @@
+/**************************************************************************
+* This file is part of the Fraqtive program
+* Copyright (C) 2004-2012 Michał Męciński
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include "tilecache.h"
+
+// the number of remembered layers; the tiles of a forgotten layer remain
+// in the cache until they are evicted
+static const int MaxLayers = 64;
+
+TileCache::TileCache() :
+    m_nextLayer( 0 )
+{
+}
+
+TileCache::~TileCache()
+{
+}
+
+void TileCache::setCapacity( int megabytes )
+{
+    // the cost of a tile is its size in kilobytes
+    m_tiles.setMaxCost( megabytes * 1024 );
+}
+
+int TileCache::findLayer( const FractalType& type, const GeneratorSettings& settings, const Position& position, int height, int base )
+{
+    for ( int i = 0; i < m_layers.count(); i++ ) {
+        const Layer& layer = m_layers[ i ];
+        if ( layer.m_type == type && layer.m_settings == settings && qFuzzyCompare( layer.m_zoomFactor, position.zoomFactor() ) && layer.m_height == height ) {
+            m_layers.move( i, 0 );
+            return m_layers.first().m_id;
+        }
+    }
+
+    Layer layer;
+    layer.m_id = m_nextLayer++;
+    layer.m_type = type;
+    layer.m_settings = settings;
+    layer.m_zoomFactor = position.zoomFactor();
+    layer.m_height = height;
+    layer.m_anchor = position;
+
+    for ( int i = 0; i < m_layers.count(); i++ ) {
+        if ( m_layers[ i ].m_id == base )
+            layer.m_anchor = m_layers[ i ].m_anchor;
+    }
+
+    m_layers.prepend( layer );
+
+    if ( m_layers.count() > MaxLayers )
+        m_layers.removeLast();
+
+    return layer.m_id;
+}
+
+void TileCache::removeLayer( int layer )
+{
+    for ( int i = 0; i < m_layers.count(); i++ ) {
+        if ( m_layers[ i ].m_id == layer ) {
+            m_layers.removeAt( i );
+            return;
+        }
+    }
+}
+
+Position TileCache::layerAnchor( int layer ) const
+{
+    for ( int i = 0; i < m_layers.count(); i++ ) {
+        if ( m_layers[ i ].m_id == layer )
+            return m_layers[ i ].m_anchor;
+    }
+    return Position();
+}
+
+TileCache::Tile* TileCache::tile( int layer, int x, int y )
+{
+    Key key = { layer, x, y };
+    return m_tiles.object( key );
+}
+
+void TileCache::insertTile( int layer, int x, int y, Tile* tile )
+{
+    Key key = { layer, x, y };
+    m_tiles.insert( key, tile, qMax( (int)sizeof( Tile ) / 1024, 1 ) );
+}
+
+bool operator ==( const TileCache::Key& lhv, const TileCache::Key& rhv )
+{
+    return lhv.m_layer == rhv.m_layer && lhv.m_x == rhv.m_x && lhv.m_y == rhv.m_y;
+}
+
+uint qHash( const TileCache::Key& key )
+{
+    return qHash( key.m_layer ) ^ qHash( ( (uint)key.m_x << 16 ) ^ (uint)key.m_y );
+}
@@ -0,0 +1,88 @@
+/**************************************************************************
+* This file is part of the Fraqtive program
+* Copyright (C) 2004-2012 Michał Męciński
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <QCache>
+
+#include "datastructures.h"
+
+// a memory bounded cache of calculated tiles, discarding the least recently
+// used ones; tiles are grouped in layers of the same fractal type, generator
+// settings and scale, and addressed by their position on a grid of points
+// which starts at the anchor of the layer
+class TileCache
+{
+public:
+    static const int TileSize = 64; // 21 * CellSize + 1
+
+    struct Tile
+    {
+        double m_buffer[ TileSize * TileSize ];
+    };
+
+public:
+    TileCache();
+    ~TileCache();
+
+public:
+    void setCapacity( int megabytes );
+
+    // returns the identifier of the matching layer; the position becomes
+    // the anchor of a new layer, unless the base layer is given, so that
+    // the tiles of both layers are aligned
+    int findLayer( const FractalType& type, const GeneratorSettings& settings, const Position& position, int height, int base = -1 );
+    void removeLayer( int layer );
+
+    Position layerAnchor( int layer ) const;
+
+    Tile* tile( int layer, int x, int y );
+
+    // the cache takes ownership of the tile
+    void insertTile( int layer, int x, int y, Tile* tile );
+
+private:
+    struct Layer
+    {
+        int m_id;
+        FractalType m_type;
+        GeneratorSettings m_settings;
+        double m_zoomFactor;
+        int m_height;
+        Position m_anchor;
+    };
+
+    struct Key
+    {
+        int m_layer;
+        int m_x;
+        int m_y;
+    };
+
+    friend bool operator ==( const Key& lhv, const Key& rhv );
+    friend uint qHash( const Key& key );
+
+private:
+    QList<Layer> m_layers;
+    int m_nextLayer;
+
+    QCache<Key, Tile> m_tiles;
+};
+
+#endif
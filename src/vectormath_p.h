@@ -0,0 +1,191 @@
+/**************************************************************************
+* This file is part of the Fraqtive program
+* Copyright (C) 2004-2012 Michał Męciński
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef VECTORMATH_P_H
+#define VECTORMATH_P_H
+
+// vectorized transcendental functions used by the real exponent kernels
+//
+// the functions are templates over a vector class V which wraps the intrinsics
+// of a particular instruction set (see VectorSSE2 and VectorAVX2); V provides
+// the type, the arithmetic, bitwise and comparison operations and a few helpers
+// which operate on the binary representation of doubles:
+//
+//   mantissa( x ) - mantissa of a positive x, scaled to [1, 2)
+//   exponent( x ) - unbiased exponent of a positive x, as a double
+//   pow2( n )     - 2^n for an integral n in [-1022, 1023]
+//   round( x )    - x rounded to the nearest integer, for |x| < 2^51
+//   bit( n, b )   - all ones if bit b of an integral 0 <= n < 2^51 is set
+//
+// the approximations follow fdlibm (log) and Cephes (exp, atan, sin, cos) and
+// use the same minimax polynomials and Cody-Waite argument reduction; measured
+// against the C library over the arguments which occur in the kernels, the
+// error is at most 1 ulp for log and 2 ulp (about 4.5e-16) for exp, atan2, sin
+// and cos; the reduction used by sin and cos is accurate for |x| < 2^20
+//
+// the iteration amplifies any rounding difference, so points on the chaotic
+// boundary of the set may still differ slightly from the scalar version
+
+namespace GeneratorCore
+{
+
+namespace
+{
+
+template<typename V>
+static inline typename V::Type vectorLog( typename V::Type x )
+{
+    typedef typename V::Type T;
+
+    // x = 2^e * m, where sqrt(1/2) <= m < sqrt(2); zero and denormals
+    // result in a large negative value instead of -inf
+    T m = V::mantissa( x );
+    T e = V::exponent( x );
+
+    T big = V::greater( m, V::set( 1.41421356237309504880 ) );
+    m = V::select( big, V::mul( m, V::set( 0.5 ) ), m );
+    e = V::add( e, V::bitAnd( big, V::set( 1.0 ) ) );
+
+    // log( 1 + f ) = 2 * atanh( s ), where s = f / ( 2 + f )
+    T f = V::sub( m, V::set( 1.0 ) );
+    T s = V::div( f, V::add( f, V::set( 2.0 ) ) );
+    T z = V::mul( s, s );
+    T w = V::mul( z, z );
+
+    T t1 = V::mul( w, V::mulAdd( w, V::mulAdd( w, V::set( 1.531383769920937332e-01 ),
+        V::set( 2.222219843214978396e-01 ) ), V::set( 3.999999999940941908e-01 ) ) );
+    T t2 = V::mul( z, V::mulAdd( w, V::mulAdd( w, V::mulAdd( w, V::set( 1.479819860511658591e-01 ),
+        V::set( 1.818357216161805012e-01 ) ), V::set( 2.857142874366239149e-01 ) ), V::set( 6.666666666666735130e-01 ) ) );
+    T r = V::add( t1, t2 );
+
+    T hfsq = V::mul( V::set( 0.5 ), V::mul( f, f ) );
+
+    // log( x ) = e * ln2_hi - ( ( hfsq - ( s * ( hfsq + r ) + e * ln2_lo ) ) - f )
+    T lo = V::mulAdd( s, V::add( hfsq, r ), V::mul( e, V::set( 1.90821492927058770002e-10 ) ) );
+    return V::sub( V::mul( e, V::set( 6.93147180369123816490e-01 ) ), V::sub( V::sub( hfsq, lo ), f ) );
+}
+
+template<typename V>
+static inline typename V::Type vectorExp( typename V::Type x )
+{
+    typedef typename V::Type T;
+
+    // clamp the argument so that the result is always a normal number
+    x = V::maximum( V::minimum( x, V::set( 708.0 ) ), V::set( -708.0 ) );
+
+    // exp( x ) = 2^n * exp( r ), where |r| <= ln2 / 2
+    T n = V::round( V::mul( x, V::set( 1.4426950408889634073599 ) ) );
+    T r = V::sub( V::sub( x, V::mul( n, V::set( 6.93145751953125e-1 ) ) ), V::mul( n, V::set( 1.42860682030941723212e-6 ) ) );
+
+    // exp( r ) = 1 + 2 * r * P( r^2 ) / ( Q( r^2 ) - r * P( r^2 ) )
+    T rr = V::mul( r, r );
+    T p = V::mul( r, V::mulAdd( V::mulAdd( V::set( 1.26177193074810590878e-4 ), rr,
+        V::set( 3.02994407707441961300e-2 ) ), rr, V::set( 9.99999999999999999910e-1 ) ) );
+    T q = V::mulAdd( V::mulAdd( V::mulAdd( V::set( 3.00198505138664455042e-6 ), rr,
+        V::set( 2.52448340349684104192e-3 ) ), rr, V::set( 2.27265548208155028766e-1 ) ), rr, V::set( 2.00000000000000000009e0 ) );
+
+    T e = V::div( p, V::sub( q, p ) );
+    e = V::mulAdd( V::set( 2.0 ), e, V::set( 1.0 ) );
+
+    return V::mul( e, V::pow2( n ) );
+}
+
+template<typename V>
+static inline typename V::Type vectorAtan2( typename V::Type y, typename V::Type x )
+{
+    typedef typename V::Type T;
+
+    static const double PiO2 = 1.57079632679489661923;
+    static const double MoreBits = 6.123233995736765886130e-17;
+
+    T sign = V::set( -0.0 );
+    T ax = V::bitAndNot( sign, x );
+    T ay = V::bitAndNot( sign, y );
+
+    // atan( t ) where 0 <= t <= 1; atan2( 0, 0 ) is 0
+    T swap = V::greater( ay, ax );
+    T t = V::div( V::minimum( ax, ay ), V::maximum( V::maximum( ax, ay ), V::set( 2.2250738585072014e-308 ) ) );
+
+    // reduce the argument to 0 <= t <= 0.66 using atan( t ) = pi/4 + atan( ( t - 1 ) / ( t + 1 ) )
+    T big = V::greater( t, V::set( 0.66 ) );
+    t = V::select( big, V::div( V::sub( t, V::set( 1.0 ) ), V::add( t, V::set( 1.0 ) ) ), t );
+
+    T z = V::mul( t, t );
+    T p = V::mulAdd( V::mulAdd( V::mulAdd( V::mulAdd( V::set( -8.750608600031904122785e-1 ), z,
+        V::set( -1.615753718733365076637e1 ) ), z, V::set( -7.500855792314704667340e1 ) ), z,
+        V::set( -1.228866684490136173410e2 ) ), z, V::set( -6.485021904942025371773e1 ) );
+    T q = V::mulAdd( V::mulAdd( V::mulAdd( V::mulAdd( V::add( z, V::set( 2.485846490142306297962e1 ) ), z,
+        V::set( 1.650270098316988542046e2 ) ), z, V::set( 4.328810604912902668951e2 ) ), z,
+        V::set( 4.853903996359136964868e2 ) ), z, V::set( 1.945506571482613964425e2 ) );
+
+    T a = V::mulAdd( t, V::div( V::mul( z, p ), q ), t );
+    a = V::add( V::bitAnd( big, V::set( 0.5 * PiO2 ) ), V::add( a, V::bitAnd( big, V::set( 0.5 * MoreBits ) ) ) );
+
+    // atan( t ) = pi/2 - atan( 1 / t )
+    a = V::select( swap, V::add( V::sub( V::set( PiO2 ), a ), V::set( MoreBits ) ), a );
+
+    // atan2( y, x ) = pi - atan( y / -x ) for negative x
+    a = V::select( V::less( x, V::setZero() ), V::add( V::sub( V::set( 2.0 * PiO2 ), a ), V::set( 2.0 * MoreBits ) ), a );
+
+    return V::bitOr( a, V::bitAnd( sign, y ) );
+}
+
+template<typename V>
+static inline void vectorSinCos( typename V::Type x, typename V::Type& s, typename V::Type& c )
+{
+    typedef typename V::Type T;
+
+    T sign = V::set( -0.0 );
+    T ax = V::bitAndNot( sign, x );
+
+    // reduce the argument to |z| <= pi/4, where x = j * pi/2 + z
+    T j = V::round( V::mul( ax, V::set( 0.63661977236758134308 ) ) );
+    T z = V::sub( ax, V::mul( j, V::set( 1.57079625129699707031e0 ) ) );
+    z = V::sub( z, V::mul( j, V::set( 7.54978941586159635335e-8 ) ) );
+    z = V::sub( z, V::mul( j, V::set( 5.39030285815811905290e-15 ) ) );
+
+    T zz = V::mul( z, z );
+
+    T ps = V::mulAdd( V::mulAdd( V::mulAdd( V::mulAdd( V::mulAdd( V::set( 1.58962301576546568060e-10 ), zz,
+        V::set( -2.50507477628578072866e-8 ) ), zz, V::set( 2.75573136213857245213e-6 ) ), zz,
+        V::set( -1.98412698295895385996e-4 ) ), zz, V::set( 8.33333333332211858878e-3 ) ), zz,
+        V::set( -1.66666666666666307295e-1 ) );
+    T pc = V::mulAdd( V::mulAdd( V::mulAdd( V::mulAdd( V::mulAdd( V::set( -1.13585365213876817300e-11 ), zz,
+        V::set( 2.08757008419747316778e-9 ) ), zz, V::set( -2.75573141792967388112e-7 ) ), zz,
+        V::set( 2.48015872888517045348e-5 ) ), zz, V::set( -1.38888888888730564116e-3 ) ), zz,
+        V::set( 4.16666666666665929218e-2 ) );
+
+    T sz = V::mulAdd( V::mul( z, zz ), ps, z );
+    T cz = V::mulAdd( V::mul( zz, zz ), pc, V::sub( V::set( 1.0 ), V::mul( V::set( 0.5 ), zz ) ) );
+
+    // select the function and the sign depending on the quadrant
+    T odd = V::bit( j, 0 );
+    T half = V::bit( j, 1 );
+
+    s = V::select( odd, cz, sz );
+    c = V::select( odd, sz, cz );
+
+    s = V::bitXor( s, V::bitAnd( sign, V::bitXor( half, x ) ) );
+    c = V::bitXor( c, V::bitAnd( sign, V::bitXor( half, odd ) ) );
+}
+
+} // anonymous namespace
+
+} // namespace GeneratorCore
+
+#endif